@@ -103,6 +103,20 @@ public:
 			   ((uint64_t)data[offset + 6] << 8) + ((uint64_t)data[offset + 7]);
 	}
 
+	// Converts count consecutive big-endian 64-bit values at once. The OR of shifted bytes is
+	// recognized by compilers and turned into a single load and byte swap per value.
+	static inline void ToUInt64BEArray(uint64_t* dest, const uint8_t* data, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint8_t* src = data + i * 8;
+			dest[i] = ((uint64_t)src[0] << 56) | ((uint64_t)src[1] << 48) |
+			          ((uint64_t)src[2] << 40) | ((uint64_t)src[3] << 32) |
+			          ((uint64_t)src[4] << 24) | ((uint64_t)src[5] << 16) |
+			          ((uint64_t)src[6] << 8) | ((uint64_t)src[7]);
+		}
+	}
+
 	static inline float ToFloatBE(const uint8_t* data, int32_t offset)
 	{
 		float value;
@@ -0,0 +1 @@
+const char gBuildHash[] = "bd1b966";
@@ -1,23 +1,76 @@
 #pragma once
 
-static uint32_t CRC32B(unsigned char* message, int32_t size)
+#include <cstdint>
+
+/*
+ * Note: the original bitwise implementation kept the CRC in a signed integer, so every shift right
+ * was arithmetic and copied bit 31 instead of clearing it. That makes this a variant of the
+ * standard CRC-32, but since Texture Pool XMLs are made of these values the tables below are built
+ * from that exact step.
+ *
+ * The step is still linear, so 8 bytes can be processed at once: the new CRC is the XOR of the
+ * contribution of every byte of the old CRC (crcTables) and of every data byte (dataTables).
+ */
+namespace CRC32Tables
+{
+constexpr uint32_t StepBit(uint32_t crc)
 {
-	int32_t byte, crc;
-	int32_t mask;
+	uint32_t mask = -(crc & 1);
+	return ((crc >> 1) | (crc & 0x80000000)) ^ (0xEDB88320 & mask);
+}
 
-	crc = 0xFFFFFFFF;
+constexpr uint32_t StepBits(uint32_t crc, int32_t count)
+{
+	for (int32_t i = 0; i < count; i++)
+		crc = StepBit(crc);
 
-	for (int32_t i = 0; i < size; i++)
-	{
-		byte = message[i];
-		crc = crc ^ byte;
+	return crc;
+}
 
-		for (int32_t j = 7; j >= 0; j--)
+struct Tables
+{
+	uint32_t crcTables[4][256] = {};
+	uint32_t dataTables[8][256] = {};
+
+	constexpr Tables()
+	{
+		for (uint32_t i = 0; i < 256; i++)
 		{
-			mask = -(crc & 1);
-			crc = (crc >> 1) ^ (0xEDB88320 & mask);
+			for (int32_t k = 0; k < 4; k++)
+				crcTables[k][i] = StepBits(i << (k * 8), 64);
+
+			for (int32_t k = 0; k < 8; k++)
+				dataTables[k][i] = StepBits(i, (8 - k) * 8);
 		}
 	}
+};
+
+inline constexpr Tables tables;
+}  // namespace CRC32Tables
+
+static uint32_t CRC32B(const unsigned char* message, int32_t size)
+{
+	const auto& crcTables = CRC32Tables::tables.crcTables;
+	const auto& dataTables = CRC32Tables::tables.dataTables;
+	uint32_t crc = 0xFFFFFFFF;
+	int32_t i = 0;
+
+	for (; i + 8 <= size; i += 8)
+	{
+		const unsigned char* m = message + i;
+
+		crc = crcTables[0][crc & 0xFF] ^ crcTables[1][(crc >> 8) & 0xFF] ^
+		      crcTables[2][(crc >> 16) & 0xFF] ^ crcTables[3][crc >> 24] ^ dataTables[0][m[0]] ^
+		      dataTables[1][m[1]] ^ dataTables[2][m[2]] ^ dataTables[3][m[3]] ^
+		      dataTables[4][m[4]] ^ dataTables[5][m[5]] ^ dataTables[6][m[6]] ^
+		      dataTables[7][m[7]];
+	}
+
+	for (; i < size; i++)
+	{
+		uint32_t signFill = (crc & 0x80000000) ? 0xFF000000 : 0;
+		crc = ((crc >> 8) | signFill) ^ dataTables[7][(crc ^ message[i]) & 0xFF];
+	}
 
-	return ~(uint32_t)(crc);
-}
\ No newline at end of file
+	return ~crc;
+}
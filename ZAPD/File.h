@@ -58,6 +58,12 @@ public:
 		file.write((char*)data.data(), data.size());
 	};
 
+	static void WriteAllBytes(const fs::path& filePath, const char* data, size_t dataSize)
+	{
+		std::ofstream file(filePath, std::ios::binary);
+		file.write(data, dataSize);
+	};
+
 	static void WriteAllText(const fs::path& filePath, const std::string& text)
 	{
 		std::ofstream file(filePath, std::ios::out);
@@ -1,5 +1,6 @@
 #include "Globals.h"
 #include <algorithm>
+#include <thread>
 #include "File.h"
 #include "Path.h"
 #include "tinyxml2.h"
@@ -13,7 +14,7 @@ Globals::Globals()
 	Instance = this;
 
 	files = std::vector<ZFile*>();
-	segments = std::vector<int32_t>();
+	segments = std::unordered_set<int32_t>();
 	symbolMap = std::map<uint32_t, std::string>();
 	segmentRefs = std::map<int32_t, std::string>();
 	segmentRefFiles = std::map<int32_t, ZFile*>();
@@ -78,6 +79,8 @@ void Globals::ReadConfigFile(const std::string& configFilePath)
 
 	XMLNode* root = doc.FirstChild();
 
+	configFilePaths.push_back(configFilePath);
+
 	if (root == nullptr)
 		return;
 
@@ -88,35 +91,32 @@ void Globals::ReadConfigFile(const std::string& configFilePath)
 		{
 			std::string fileName = std::string(child->Attribute("File"));
 			GenSymbolMap(Path::GetDirectoryName(configFilePath) + "/" + fileName);
+			configFilePaths.push_back(Path::GetDirectoryName(configFilePath) + "/" + fileName);
 		}
 		else if (std::string(child->Name()) == "Segment")
 		{
 			std::string fileName = std::string(child->Attribute("File"));
 			int32_t segNumber = child->IntAttribute("Number");
 			segmentRefs[segNumber] = fileName;
+			configFilePaths.push_back(fileName);
 		}
 		else if (std::string(child->Name()) == "ActorList")
 		{
 			std::string fileName = std::string(child->Attribute("File"));
-			std::vector<std::string> lines =
-				File::ReadAllLines(Path::GetDirectoryName(configFilePath) + "/" + fileName);
-
-			for (std::string line : lines)
-				cfg.actorList.push_back(StringHelper::Strip(line, "\r"));
+			cfg.actorList.ReadFromFile(Path::GetDirectoryName(configFilePath) + "/" + fileName);
+			configFilePaths.push_back(Path::GetDirectoryName(configFilePath) + "/" + fileName);
 		}
 		else if (std::string(child->Name()) == "ObjectList")
 		{
 			std::string fileName = std::string(child->Attribute("File"));
-			std::vector<std::string> lines =
-				File::ReadAllLines(Path::GetDirectoryName(configFilePath) + "/" + fileName);
-
-			for (std::string line : lines)
-				cfg.objectList.push_back(StringHelper::Strip(line, "\r"));
+			cfg.objectList.ReadFromFile(Path::GetDirectoryName(configFilePath) + "/" + fileName);
+			configFilePaths.push_back(Path::GetDirectoryName(configFilePath) + "/" + fileName);
 		}
 		else if (std::string(child->Name()) == "TexturePool")
 		{
 			std::string fileName = std::string(child->Attribute("File"));
 			ReadTexturePool(Path::GetDirectoryName(configFilePath) + "/" + fileName);
+			configFilePaths.push_back(Path::GetDirectoryName(configFilePath) + "/" + fileName);
 		}
 		else if (std::string(child->Name()) == "BGConfig")
 		{
@@ -158,6 +158,142 @@ void Globals::ReadTexturePool(const std::string& texturePoolXmlPath)
 	}
 }
 
+void Globals::WriteTexturePool(const fs::path& texturePoolXmlPath)
+{
+	XMLDocument doc;
+	XMLElement* root = doc.NewElement("TexturePool");
+	doc.InsertFirstChild(root);
+
+	for (const auto& entry : cfg.texturePool)
+	{
+		XMLElement* child = doc.NewElement("Texture");
+		child->SetAttribute("CRC", StringHelper::Sprintf("%08X", entry.first).c_str());
+		child->SetAttribute("Path", entry.second.path.string().c_str());
+		root->InsertEndChild(child);
+	}
+
+	XMLError eResult = doc.SaveFile(texturePoolXmlPath.string().c_str());
+
+	if (eResult != tinyxml2::XML_SUCCESS)
+		fprintf(stderr, "Warning: Unable to write texture pool XML with error code %i\n", eResult);
+}
+
+void Globals::ReadRoomCache(const fs::path& roomCacheXmlPath)
+{
+	// There's nothing to skip on the first run
+	if (!File::Exists(roomCacheXmlPath.string()))
+		return;
+
+	XMLDocument doc;
+	XMLError eResult = doc.LoadFile(roomCacheXmlPath.string().c_str());
+
+	if (eResult != tinyxml2::XML_SUCCESS)
+	{
+		fprintf(stderr, "Warning: Unable to read room cache XML with error code %i\n", eResult);
+		return;
+	}
+
+	XMLNode* root = doc.FirstChild();
+
+	if (root == nullptr)
+		return;
+
+	for (XMLElement* child = root->FirstChildElement(); child != NULL;
+	     child = child->NextSiblingElement())
+	{
+		if (std::string(child->Name()) != "Room")
+			continue;
+
+		const char* name = child->Attribute("Name");
+		const char* hash = child->Attribute("Hash");
+
+		if (name == nullptr || hash == nullptr)
+		{
+			fprintf(stderr,
+			        "Warning: Skipping a room cache entry without a 'Name' or 'Hash' attribute on "
+			        "line %i\n",
+			        child->GetLineNum());
+			continue;
+		}
+
+		RoomCacheEntry entry;
+		entry.hash = strtoul(hash, NULL, 16);
+		bool isValid = true;
+
+		for (XMLElement* texElement = child->FirstChildElement("SceneTexture");
+		     texElement != NULL; texElement = texElement->NextSiblingElement("SceneTexture"))
+		{
+			if (texElement->Attribute("Offset") == nullptr)
+			{
+				// Without all of its scene textures the room can't be skipped safely
+				fprintf(stderr,
+				        "Warning: Skipping the room cache entry of '%s', one of its scene textures "
+				        "has no 'Offset' attribute\n",
+				        name);
+				isValid = false;
+				break;
+			}
+
+			SceneTextureRef ref;
+			ref.offset = strtoul(texElement->Attribute("Offset"), NULL, 16);
+			ref.width = texElement->IntAttribute("Width");
+			ref.height = texElement->IntAttribute("Height");
+			ref.format = static_cast<TextureType>(texElement->IntAttribute("Format"));
+			ref.isPalette = texElement->BoolAttribute("Palette");
+			entry.sceneTextures.push_back(ref);
+		}
+
+		for (XMLElement* outElement = child->FirstChildElement("OutputFile");
+		     outElement != NULL; outElement = outElement->NextSiblingElement("OutputFile"))
+		{
+			if (outElement->Attribute("Path") != nullptr)
+				entry.outputFiles.push_back(outElement->Attribute("Path"));
+		}
+
+		if (isValid)
+			roomCache[name] = entry;
+	}
+}
+
+void Globals::WriteRoomCache(const fs::path& roomCacheXmlPath)
+{
+	XMLDocument doc;
+	XMLElement* root = doc.NewElement("RoomCache");
+	doc.InsertFirstChild(root);
+
+	for (const auto& entry : roomCache)
+	{
+		XMLElement* child = doc.NewElement("Room");
+		child->SetAttribute("Name", entry.first.c_str());
+		child->SetAttribute("Hash", StringHelper::Sprintf("%08X", entry.second.hash).c_str());
+
+		for (const SceneTextureRef& ref : entry.second.sceneTextures)
+		{
+			XMLElement* texElement = doc.NewElement("SceneTexture");
+			texElement->SetAttribute("Offset", StringHelper::Sprintf("0x%06X", ref.offset).c_str());
+			texElement->SetAttribute("Width", ref.width);
+			texElement->SetAttribute("Height", ref.height);
+			texElement->SetAttribute("Format", static_cast<int32_t>(ref.format));
+			texElement->SetAttribute("Palette", ref.isPalette);
+			child->InsertEndChild(texElement);
+		}
+
+		for (const fs::path& outputFile : entry.second.outputFiles)
+		{
+			XMLElement* outElement = doc.NewElement("OutputFile");
+			outElement->SetAttribute("Path", outputFile.string().c_str());
+			child->InsertEndChild(outElement);
+		}
+
+		root->InsertEndChild(child);
+	}
+
+	XMLError eResult = doc.SaveFile(roomCacheXmlPath.string().c_str());
+
+	if (eResult != tinyxml2::XML_SUCCESS)
+		fprintf(stderr, "Warning: Unable to write room cache XML with error code %i\n", eResult);
+}
+
 void Globals::GenSymbolMap(const std::string& symbolMapPath)
 {
 	auto symbolLines = File::ReadAllLines(symbolMapPath);
@@ -174,8 +310,7 @@ void Globals::GenSymbolMap(const std::string& symbolMapPath)
 
 void Globals::AddSegment(int32_t segment, ZFile* file)
 {
-	if (std::find(segments.begin(), segments.end(), segment) == segments.end())
-		segments.push_back(segment);
+	segments.insert(segment);
 
 	segmentRefs[segment] = file->GetXmlFilePath();
 	segmentRefFiles[segment] = file;
@@ -183,5 +318,76 @@ void Globals::AddSegment(int32_t segment, ZFile* file)
 
 bool Globals::HasSegment(int32_t segment)
 {
-	return std::find(segments.begin(), segments.end(), segment) != segments.end();
+	return segments.find(segment) != segments.end();
+}
+
+void Globals::AddScene(ZRoom* scene)
+{
+	scenes[scene->GetName()] = scene;
+	lastScene = scene;
+}
+
+void Globals::RemoveScene(ZRoom* scene)
+{
+	auto it = scenes.find(scene->GetName());
+
+	if (it != scenes.end() && it->second == scene)
+		scenes.erase(it);
+
+	if (lastScene == scene)
+		lastScene = nullptr;
+}
+
+ZRoom* Globals::FindScene(const std::string& sceneName) const
+{
+	auto it = scenes.find(sceneName);
+
+	if (it == scenes.end())
+		return nullptr;
+
+	return it->second;
+}
+
+size_t Globals::GetWorkerCount(size_t workCount) const
+{
+	size_t workers = jobs;
+
+	if (workers == 0)
+		workers = std::max(std::thread::hardware_concurrency(), 1u);
+
+	return std::min(workers, workCount);
+}
+
+void NameTable::ReadFromFile(const fs::path& filePath)
+{
+	std::string text = File::ReadAllText(filePath);
+	size_t lineStart = 0;
+
+	pool.reserve(pool.size() + text.size());
+
+	while (lineStart < text.size())
+	{
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = text.size();
+
+		// Lists saved with Windows line endings
+		size_t nameEnd = std::min(text.find('\r', lineStart), lineEnd);
+
+		offsets.push_back(pool.size());
+		pool.append(text, lineStart, nameEnd - lineStart);
+		lineStart = lineEnd + 1;
+	}
+}
+
+std::string NameTable::GetName(size_t id) const
+{
+	size_t nameEnd = (id + 1 < offsets.size()) ? offsets[id + 1] : pool.size();
+
+	return pool.substr(offsets.at(id), nameEnd - offsets.at(id));
+}
+
+size_t NameTable::GetCount() const
+{
+	return offsets.size();
 }
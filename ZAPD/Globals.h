@@ -2,11 +2,14 @@
 
 #include <map>
 #include <string>
+#include <unordered_set>
 #include <vector>
 #include "ZFile.h"
 #include "ZRoom/ZRoom.h"
 #include "ZTexture.h"
 
+class WorkerPool;
+
 enum class VerbosityLevel
 {
 	VERBOSITY_SILENT,
@@ -17,6 +20,30 @@ enum class VerbosityLevel
 struct TexturePoolEntry
 {
 	fs::path path = "";  // Path to Shared Texture
+	TextureType format = TextureType::Error;  // Only set for entries added by `-dt`
+	bool written = false;  // The PNG has already been saved by an earlier texture
+};
+
+// What `-rc` remembers about a room file extracted by an earlier run
+struct RoomCacheEntry
+{
+	uint32_t hash = 0;  // Of the room's bytes, its XML and its scene, see GetRoomFileHash
+	std::vector<SceneTextureRef> sceneTextures;
+	std::vector<fs::path> outputFiles;  // The room can only be skipped if all of them still exist
+};
+
+// A list of names from a config file, one per line, where the line number is the id. All the
+// names share a single string and are found through their start offset.
+class NameTable
+{
+public:
+	void ReadFromFile(const fs::path& filePath);
+	std::string GetName(size_t id) const;
+	size_t GetCount() const;
+
+protected:
+	std::string pool;
+	std::vector<size_t> offsets;
 };
 
 class GameConfig
@@ -25,8 +52,8 @@ public:
 	std::map<int32_t, std::string> segmentRefs;
 	std::map<int32_t, ZFile*> segmentRefFiles;
 	std::map<uint32_t, std::string> symbolMap;
-	std::vector<std::string> actorList;
-	std::vector<std::string> objectList;
+	NameTable actorList;
+	NameTable objectList;
 	std::map<uint32_t, TexturePoolEntry> texturePool;  // Key = CRC
 
 	// ZBackground
@@ -44,30 +71,47 @@ public:
 	bool useExternalResources;
 	bool testMode;  // Enables certain experimental features
 	bool outputCrc = false;
+	bool dedupTextures = false;  // Write textures with the same CRC only once
+	fs::path texturePoolOutPath;  // Texture Pool XML written after extraction, if any
+	fs::path dlStatsPath;  // Display list statistics report written after extraction, if any
+	std::string dlStatsReport;
+	fs::path roomCachePath;  // Skip the rooms which haven't changed since this cache was written
+	std::map<std::string, RoomCacheEntry> roomCache;  // Key = Room's File name
 	bool profile;  // Measure performance of certain operations
 	bool useLegacyZDList;
 	VerbosityLevel verbosity;  // ZAPD outputs additional information
 	ZFileMode fileMode;
 	fs::path baseRomPath, inputPath, outputPath, sourceOutputPath, cfgPath;
+	std::vector<fs::path> configFilePaths;  // The config file and every file it references
 	TextureType texType;
 	ZGame game;
 	GameConfig cfg;
 	bool warnUnaccounted = false;
+	uint32_t jobs = 1;  // Worker threads for parallel modes, 0 means one per hardware thread
+	WorkerPool* workerPool = nullptr;  // Only exists while Parse runs with more than one job
 
 	std::vector<ZFile*> files;
-	std::vector<int32_t> segments;
+	std::unordered_set<int32_t> segments;
 	std::map<int32_t, std::string> segmentRefs;
 	std::map<int32_t, ZFile*> segmentRefFiles;
-	ZRoom* lastScene;
+	ZRoom* lastScene;  // Used by rooms which don't specify their scene explicitly
+	std::map<std::string, ZRoom*> scenes;  // Key = Scene name
 	std::map<uint32_t, std::string> symbolMap;
 
 	Globals();
 	std::string FindSymbolSegRef(int32_t segNumber, uint32_t symbolAddress);
 	void ReadConfigFile(const std::string& configFilePath);
 	void ReadTexturePool(const std::string& texturePoolXmlPath);
+	void WriteTexturePool(const fs::path& texturePoolXmlPath);
+	void ReadRoomCache(const fs::path& roomCacheXmlPath);
+	void WriteRoomCache(const fs::path& roomCacheXmlPath);
 	void GenSymbolMap(const std::string& symbolMapPath);
 	void AddSegment(int32_t segment, ZFile* file);
 	bool HasSegment(int32_t segment);
+	void AddScene(ZRoom* scene);
+	void RemoveScene(ZRoom* scene);
+	ZRoom* FindScene(const std::string& sceneName) const;
+	size_t GetWorkerCount(size_t workCount) const;
 };
 
 /*
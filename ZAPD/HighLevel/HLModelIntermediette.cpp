@@ -65,7 +65,7 @@ void HLModelIntermediette::FromZDisplayList(HLModelIntermediette* model, ZDispla
 	limb->name = zDisplayList->GetName();
 
 	// Go through verts
-	std::vector<ZVtx> finalVerts;
+	std::vector<VtxEntry> finalVerts;
 
 	int32_t vStart = -1;
 
@@ -455,7 +455,7 @@ void HLMeshCommand::OutputXML(tinyxml2::XMLElement* parent)
 
 HLVerticesIntermediette::HLVerticesIntermediette() : HLIntermediette()
 {
-	vertices = std::vector<ZVtx>();
+	vertices = std::vector<VtxEntry>();
 }
 
 void HLVerticesIntermediette::InitFromXML(XMLElement* verticesElement)
@@ -473,7 +473,7 @@ void HLVerticesIntermediette::InitFromXML(XMLElement* verticesElement)
 	*/
 }
 
-void HLVerticesIntermediette::InitFromVertices(std::vector<ZVtx> dispListVertices)
+void HLVerticesIntermediette::InitFromVertices(std::vector<VtxEntry> dispListVertices)
 {
 	for (auto v : dispListVertices)
 		vertices.push_back(v);
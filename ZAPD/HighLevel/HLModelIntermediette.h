@@ -156,12 +156,12 @@ public:
 class HLVerticesIntermediette : public HLIntermediette
 {
 public:
-	std::vector<ZVtx> vertices;
+	std::vector<VtxEntry> vertices;
 
 	HLVerticesIntermediette();
 
 	virtual void InitFromXML(tinyxml2::XMLElement* verticesElement);
-	void InitFromVertices(std::vector<ZVtx> dispListVertices);
+	void InitFromVertices(std::vector<VtxEntry> dispListVertices);
 	virtual std::string OutputCode(HLModelIntermediette* parent);
 	virtual std::string OutputOBJ();
 	virtual void OutputAssimp(aiScene* scene, std::vector<aiVector3D>* verts);
@@ -144,6 +144,42 @@ void ImageBackend::WritePng(const char* filename)
 {
 	assert(hasImageData);
 
+#ifdef TEXTURE_DEBUG
+	size_t bytePerPixel = GetBytesPerPixel();
+	printf("imgData\n");
+	for (size_t y = 0; y < height; y++)
+	{
+		for (size_t x = 0; x < width * bytePerPixel; x++)
+		{
+			printf("%02X ", pixelMatrix[y][x]);
+		}
+		printf("\n");
+	}
+	printf("\n");
+#endif
+
+	WritePngImpl(filename, [this](size_t y) { return pixelMatrix[y]; });
+}
+
+void ImageBackend::WritePng(const fs::path& filename)
+{
+	WritePng(filename.c_str());
+}
+
+void ImageBackend::WritePngRows(const fs::path& filename,
+                                const std::function<void(size_t y, uint8_t* row)>& prepareRow)
+{
+	std::vector<uint8_t> row(width * GetBytesPerPixel());
+
+	WritePngImpl(filename.c_str(), [&](size_t y) {
+		prepareRow(y, row.data());
+		return row.data();
+	});
+}
+
+void ImageBackend::WritePngImpl(const char* filename,
+                                const std::function<uint8_t*(size_t y)>& getRow)
+{
 	FILE* fp = fopen(filename, "wb");
 	if (!fp)
 		throw std::runtime_error(StringHelper::Sprintf(
@@ -192,21 +228,9 @@ void ImageBackend::WritePng(const char* filename)
 	// Use png_set_filler().
 	// png_set_filler(png, 0, PNG_FILLER_AFTER);
 
-#ifdef TEXTURE_DEBUG
-	size_t bytePerPixel = GetBytesPerPixel();
-	printf("imgData\n");
 	for (size_t y = 0; y < height; y++)
-	{
-		for (size_t x = 0; x < width * bytePerPixel; x++)
-		{
-			printf("%02X ", pixelMatrix[y][x]);
-		}
-		printf("\n");
-	}
-	printf("\n");
-#endif
+		png_write_row(png, getRow(y));
 
-	png_write_image(png, pixelMatrix);
 	png_write_end(png, nullptr);
 
 	fclose(fp);
@@ -214,11 +238,6 @@ void ImageBackend::WritePng(const char* filename)
 	png_destroy_write_struct(&png, &info);
 }
 
-void ImageBackend::WritePng(const fs::path& filename)
-{
-	WritePng(filename.c_str());
-}
-
 void ImageBackend::SetTextureData(const std::vector<std::vector<RGBAPixel>>& texData,
                                   uint32_t nWidth, uint32_t nHeight, uint8_t nColorType,
                                   uint8_t nBitDepth)
@@ -251,14 +270,7 @@ void ImageBackend::SetTextureData(const std::vector<std::vector<RGBAPixel>>& tex
 
 void ImageBackend::InitEmptyRGBImage(uint32_t nWidth, uint32_t nHeight, bool alpha)
 {
-	FreeImageData();
-
-	width = nWidth;
-	height = nHeight;
-	colorType = PNG_COLOR_TYPE_RGB;
-	if (alpha)
-		colorType = PNG_COLOR_TYPE_RGBA;
-	bitDepth = 8;  // nBitDepth;
+	InitStreamedRGBImage(nWidth, nHeight, alpha);
 
 	size_t bytePerPixel = GetBytesPerPixel();
 
@@ -273,12 +285,7 @@ void ImageBackend::InitEmptyRGBImage(uint32_t nWidth, uint32_t nHeight, bool alp
 
 void ImageBackend::InitEmptyPaletteImage(uint32_t nWidth, uint32_t nHeight)
 {
-	FreeImageData();
-
-	width = nWidth;
-	height = nHeight;
-	colorType = PNG_COLOR_TYPE_PALETTE;
-	bitDepth = 8;
+	InitStreamedPaletteImage(nWidth, nHeight);
 
 	size_t bytePerPixel = GetBytesPerPixel();
 
@@ -287,10 +294,34 @@ void ImageBackend::InitEmptyPaletteImage(uint32_t nWidth, uint32_t nHeight)
 	{
 		pixelMatrix[y] = static_cast<uint8_t*>(calloc(width * bytePerPixel, sizeof(uint8_t*)));
 	}
+
+	hasImageData = true;
+}
+
+void ImageBackend::InitStreamedRGBImage(uint32_t nWidth, uint32_t nHeight, bool alpha)
+{
+	FreeImageData();
+
+	width = nWidth;
+	height = nHeight;
+	colorType = PNG_COLOR_TYPE_RGB;
+	if (alpha)
+		colorType = PNG_COLOR_TYPE_RGBA;
+	bitDepth = 8;  // nBitDepth;
+}
+
+void ImageBackend::InitStreamedPaletteImage(uint32_t nWidth, uint32_t nHeight)
+{
+	FreeImageData();
+
+	width = nWidth;
+	height = nHeight;
+	colorType = PNG_COLOR_TYPE_PALETTE;
+	bitDepth = 8;
+
 	colorPalette = calloc(paletteSize, sizeof(png_color));
 	alphaPalette = static_cast<uint8_t*>(calloc(paletteSize, sizeof(uint8_t)));
 
-	hasImageData = true;
 	isColorIndexed = true;
 }
 
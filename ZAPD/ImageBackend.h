@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 #include "Directory.h"
@@ -29,11 +30,16 @@ public:
 	void ReadPng(const fs::path& filename);
 	void WritePng(const char* filename);
 	void WritePng(const fs::path& filename);
+	void WritePngRows(const fs::path& filename,
+	                  const std::function<void(size_t y, uint8_t* row)>& prepareRow);
 
 	void SetTextureData(const std::vector<std::vector<RGBAPixel>>& texData, uint32_t nWidth,
 	                    uint32_t nHeight, uint8_t nColorType, uint8_t nBitDepth);
 	void InitEmptyRGBImage(uint32_t nWidth, uint32_t nHeight, bool alpha);
 	void InitEmptyPaletteImage(uint32_t nWidth, uint32_t nHeight);
+	// Like the InitEmpty* functions, but without allocating the pixels. Used with WritePngRows.
+	void InitStreamedRGBImage(uint32_t nWidth, uint32_t nHeight, bool alpha);
+	void InitStreamedPaletteImage(uint32_t nWidth, uint32_t nHeight);
 
 	RGBAPixel GetPixel(size_t y, size_t x) const;
 	uint8_t GetIndexedPixel(size_t y, size_t x) const;
@@ -50,6 +56,8 @@ public:
 	uint8_t GetColorType() const;
 	uint8_t GetBitDepth() const;
 
+	void FreeImageData();
+
 protected:
 	uint8_t** pixelMatrix = nullptr;  // height * [width * bytePerPixel]
 
@@ -67,5 +75,5 @@ protected:
 
 	double GetBytesPerPixel() const;
 
-	void FreeImageData();
+	void WritePngImpl(const char* filename, const std::function<uint8_t*(size_t y)>& getRow);
 };
@@ -1,4 +1,5 @@
 #include "BuildInfo.h"
+#include "CRC32.h"
 #include "Directory.h"
 #include "File.h"
 #include "Globals.h"
@@ -6,9 +7,11 @@
 #include "HighLevel/HLModelIntermediette.h"
 #include "Overlays/ZOverlay.h"
 #include "Path.h"
+#include "WorkerPool.h"
 #include "ZAnimation.h"
 #include "ZBackground.h"
 #include "ZBlob.h"
+#include "ZDisplayList.h"
 #include "ZFile.h"
 #include "ZTexture.h"
 
@@ -22,16 +25,23 @@
 #include <unistd.h>
 #endif
 
+#include <atomic>
 #include <string>
+#include <thread>
 #include "tinyxml2.h"
 
 using namespace tinyxml2;
 
 bool Parse(const fs::path& xmlFilePath, const fs::path& basePath, ZFileMode fileMode);
+std::string GetRoomCacheOptions();
+uint32_t GetFileSourceHash(XMLElement* fileElement, const fs::path& basePath,
+                           const std::string& options);
+bool SkipUnchangedRoomFile(XMLElement* fileElement, uint32_t roomHash);
 
 void BuildAssetTexture(const fs::path& pngFilePath, TextureType texType, const fs::path& outPath);
 void BuildAssetBackground(const fs::path& imageFilePath, const fs::path& outPath);
 void BuildAssetBlob(const fs::path& blobFilePath, const fs::path& outPath);
+bool BuildAssetsFromManifest(const fs::path& manifestPath);
 void BuildAssetModelIntermediette(const fs::path& outPath);
 void BuildAssetAnimationIntermediette(const fs::path& animPath, const fs::path& outPath);
 
@@ -96,7 +106,8 @@ int main(int argc, char* argv[])
 
 	if (argc < 2)
 	{
-		printf("ZAPD.out (%s) [mode (btex/bovl/bsf/bblb/bmdlintr/bamnintr/e)] ...\n", gBuildHash);
+		printf("ZAPD.out (%s) [mode (btex/bovl/bsf/bblb/bmf/bmdlintr/bamnintr/e)] ...\n",
+		       gBuildHash);
 		return 1;
 	}
 
@@ -132,6 +143,8 @@ int main(int argc, char* argv[])
 		fileMode = ZFileMode::BuildSourceFile;
 	else if (buildMode == "bblb")
 		fileMode = ZFileMode::BuildBlob;
+	else if (buildMode == "bmf")
+		fileMode = ZFileMode::BuildManifest;
 	else if (buildMode == "bmdlintr")
 		fileMode = ZFileMode::BuildModelIntermediette;
 	else if (buildMode == "bamnintr")
@@ -189,6 +202,30 @@ int main(int argc, char* argv[])
 		{
 			Globals::Instance->outputCrc = true;
 		}
+		else if (arg == "-dt" ||
+		         arg == "--dedup-textures")  // Write each texture with the same CRC only once
+		{
+			Globals::Instance->dedupTextures = true;
+		}
+		else if (arg == "-tpo" ||
+		         arg == "--texture-pool-out")  // Write the resulting Texture Pool XML
+		{
+			Globals::Instance->texturePoolOutPath = argv[i + 1];
+			i++;
+		}
+		else if (arg == "-dls" ||
+		         arg == "--dl-stats")  // Write statistics about every display list
+		{
+			Globals::Instance->dlStatsPath = argv[i + 1];
+			i++;
+		}
+		else if (arg == "-rc" ||
+		         arg == "--room-cache")  // Skip the rooms which haven't changed since the last run
+		{
+			Globals::Instance->roomCachePath = argv[i + 1];
+			Globals::Instance->ReadRoomCache(Globals::Instance->roomCachePath);
+			i++;
+		}
 		else if (arg == "-ulzdl")  // Use Legacy ZDisplay List
 		{
 			Globals::Instance->useLegacyZDList = std::string(argv[i + 1]) == "1";
@@ -241,6 +278,20 @@ int main(int argc, char* argv[])
 		{
 			Globals::Instance->warnUnaccounted = true;
 		}
+		else if (arg == "-j" || arg == "--jobs")  // Set the number of worker threads
+		{
+			Globals::Instance->jobs = strtoul(argv[i + 1], NULL, 10);
+			i++;
+		}
+	}
+
+	// Skipped rooms don't register their textures nor disassemble their display lists, so these
+	// would give a different result than a full run
+	if (Globals::Instance->roomCachePath != "" &&
+	    (Globals::Instance->dedupTextures || Globals::Instance->dlStatsPath != ""))
+	{
+		printf("Error: '-rc' can't be used together with '-dt' or '-dls'\n");
+		return 1;
 	}
 
 	if (Globals::Instance->verbosity >= VerbosityLevel::VERBOSITY_INFO)
@@ -253,6 +304,18 @@ int main(int argc, char* argv[])
 
 		if (!parseSuccessful)
 			return 1;
+
+		if (Globals::Instance->texturePoolOutPath != "")
+			Globals::Instance->WriteTexturePool(Globals::Instance->texturePoolOutPath);
+
+		if (Globals::Instance->dlStatsPath != "")
+			File::WriteAllText(Globals::Instance->dlStatsPath, Globals::Instance->dlStatsReport);
+
+		if (Globals::Instance->roomCachePath != "")
+			Globals::Instance->WriteRoomCache(Globals::Instance->roomCachePath);
+
+		if (Globals::Instance->profile)
+			printf("%s", ZRoom::GetCommandProfileReport().c_str());
 	}
 	else if (fileMode == ZFileMode::BuildTexture)
 	{
@@ -267,6 +330,11 @@ int main(int argc, char* argv[])
 	{
 		BuildAssetBlob(Globals::Instance->inputPath, Globals::Instance->outputPath);
 	}
+	else if (fileMode == ZFileMode::BuildManifest)
+	{
+		if (!BuildAssetsFromManifest(Globals::Instance->inputPath))
+			return 1;
+	}
 	else if (fileMode == ZFileMode::BuildModelIntermediette)
 	{
 		BuildAssetModelIntermediette(Globals::Instance->outputPath);
@@ -310,13 +378,75 @@ bool Parse(const fs::path& xmlFilePath, const fs::path& basePath, ZFileMode file
 		return false;
 	}
 
+	// Room meshes are decoded while the files are constructed, so the same threads are used from
+	// here until every file is done
+	size_t workerCount = Globals::Instance->GetWorkerCount(SIZE_MAX);
+	if (workerCount > 1 && !Globals::Instance->useLegacyZDList)
+		Globals::Instance->workerPool = new WorkerPool(workerCount);
+
+	// Only filled when `-rc` is used
+	std::map<ZFile*, uint32_t> sceneSourceHashes;
+	std::map<ZFile*, uint32_t> roomHashes;
+	std::string roomCacheOptions;
+
+	if (fileMode == ZFileMode::Extract && Globals::Instance->roomCachePath != "")
+		roomCacheOptions = GetRoomCacheOptions();
+
 	for (XMLElement* child = root->FirstChildElement(); child != NULL;
 	     child = child->NextSiblingElement())
 	{
 		if (std::string(child->Name()) == "File")
 		{
+			bool useRoomCache =
+				fileMode == ZFileMode::Extract && Globals::Instance->roomCachePath != "";
+			bool hasRoom = child->FirstChildElement("Room") != nullptr;
+			bool hasScene = child->FirstChildElement("Scene") != nullptr;
+			uint32_t sourceHash = 0;
+			uint32_t roomHash = 0;
+
+			if (useRoomCache && (hasRoom || hasScene))
+				sourceHash = GetFileSourceHash(child, basePath, roomCacheOptions);
+
+			if (useRoomCache && hasRoom && !hasScene)
+			{
+				// The room's code uses the symbols of its scene, so it depends on the scene too
+				const char* sceneName = child->FirstChildElement("Room")->Attribute("Scene");
+				ZRoom* scene = Globals::Instance->lastScene;
+				if (sceneName != nullptr)
+					scene = Globals::Instance->FindScene(sceneName);
+				uint32_t sceneHash = scene != nullptr ? sceneSourceHashes[scene->parent] : 0;
+
+				std::string roomSource = StringHelper::Sprintf(
+					"%08X %08X %s", sourceHash, sceneHash,
+					scene != nullptr ? scene->GetName().c_str() : "");
+				roomHash = CRC32B(reinterpret_cast<const uint8_t*>(roomSource.data()),
+				                  roomSource.size());
+
+				if (SkipUnchangedRoomFile(child, roomHash))
+				{
+					// Its display lists won't run this time, but the scene textures they use still
+					// have to be declared in the scene's file
+					if (scene != nullptr)
+					{
+						const RoomCacheEntry& entry =
+							Globals::Instance->roomCache.at(child->Attribute("Name"));
+
+						for (const SceneTextureRef& ref : entry.sceneTextures)
+							ZDisplayList::DeclareSceneTexture(scene, ref.offset, ref.width,
+							                                  ref.height, ref.format, ref.isPalette);
+					}
+
+					continue;
+				}
+			}
+
 			ZFile* file = new ZFile(fileMode, child, basePath, "", xmlFilePath, false);
 			Globals::Instance->files.push_back(file);
+
+			if (useRoomCache && hasScene)
+				sceneSourceHashes[file] = sourceHash;
+			else if (useRoomCache && hasRoom)
+				roomHashes[file] = roomHash;
 		}
 		else
 		{
@@ -335,6 +465,17 @@ bool Parse(const fs::path& xmlFilePath, const fs::path& basePath, ZFileMode file
 			file->ExtractResources();
 	}
 
+	for (const auto& roomPair : roomHashes)
+	{
+		RoomCacheEntry& entry = Globals::Instance->roomCache[roomPair.first->GetName()];
+		entry.hash = roomPair.second;
+		entry.sceneTextures = roomPair.first->GetSceneTextureRefs();
+		entry.outputFiles = roomPair.first->GetOutputFiles();
+	}
+
+	delete Globals::Instance->workerPool;
+	Globals::Instance->workerPool = nullptr;
+
 	// All done, free files
 	for (ZFile* file : Globals::Instance->files)
 		delete file;
@@ -344,6 +485,78 @@ bool Parse(const fs::path& xmlFilePath, const fs::path& basePath, ZFileMode file
 	return true;
 }
 
+// The options which change the generated code, followed by the contents of the config file and
+// of every file it references (symbol map, segments, actor and object lists, texture pool).
+std::string GetRoomCacheOptions()
+{
+	std::string options = StringHelper::Sprintf(
+		"%s %i %i %i %i %i %s %s\n", gBuildHash, static_cast<int32_t>(Globals::Instance->game),
+		Globals::Instance->useLegacyZDList, Globals::Instance->useExternalResources,
+		Globals::Instance->testMode, Globals::Instance->outputCrc,
+		Globals::Instance->outputPath.c_str(), Globals::Instance->sourceOutputPath.c_str());
+
+	for (const fs::path& configFilePath : Globals::Instance->configFilePaths)
+	{
+		options += configFilePath.string() + "\n";
+
+		if (File::Exists(configFilePath.string()))
+		{
+			std::vector<uint8_t> rawData = File::ReadAllBytes(configFilePath.string());
+			options.append(rawData.begin(), rawData.end());
+		}
+	}
+
+	return options;
+}
+
+// Hash of everything the output of a File element depends on: its XML, the bytes of its file and
+// the options from GetRoomCacheOptions.
+uint32_t GetFileSourceHash(XMLElement* fileElement, const fs::path& basePath,
+                           const std::string& options)
+{
+	XMLPrinter printer;
+	fileElement->Accept(&printer);
+
+	std::string source = printer.CStr();
+	source += options;
+
+	fs::path filePath = basePath / fileElement->Attribute("Name");
+
+	if (File::Exists(filePath.string()))
+	{
+		std::vector<uint8_t> rawData = File::ReadAllBytes(filePath.string());
+		source.append(rawData.begin(), rawData.end());
+	}
+
+	return CRC32B(reinterpret_cast<const uint8_t*>(source.data()), source.size());
+}
+
+// A room file is skipped when the room cache has the same hash for it and every file it wrote in
+// the previous run (code, header, includes, textures...) is still there.
+bool SkipUnchangedRoomFile(XMLElement* fileElement, uint32_t roomHash)
+{
+	std::string name = fileElement->Attribute("Name");
+	auto entry = Globals::Instance->roomCache.find(name);
+
+	if (entry == Globals::Instance->roomCache.end() || entry->second.hash != roomHash)
+		return false;
+
+	// Nothing to reuse, or a cache written before the output files were recorded
+	if (entry->second.outputFiles.empty())
+		return false;
+
+	for (const fs::path& outputFile : entry->second.outputFiles)
+	{
+		if (!File::Exists(outputFile.string()))
+			return false;
+	}
+
+	if (Globals::Instance->verbosity >= VerbosityLevel::VERBOSITY_INFO)
+		printf("Skipping unchanged room file %s\n", name.c_str());
+
+	return true;
+}
+
 void BuildAssetTexture(const fs::path& pngFilePath, TextureType texType, const fs::path& outPath)
 {
 	std::string name = outPath.stem().string();
@@ -370,14 +583,174 @@ void BuildAssetBackground(const fs::path& imageFilePath, const fs::path& outPath
 
 void BuildAssetBlob(const fs::path& blobFilePath, const fs::path& outPath)
 {
-	ZBlob* blob = ZBlob::FromFile(blobFilePath.string());
-	std::string name = outPath.stem().string();  // filename without extension
+	ZBlob::BuildSourceFile(blobFilePath, outPath);
+}
 
-	std::string src = blob->GetSourceOutputCode(name);
+struct ManifestEntry
+{
+	ZFileMode mode;
+	TextureType texType = TextureType::Error;
+	fs::path inputPath;
+	fs::path outputPath;
+};
+
+// An entry is up to date if its output is newer than its input.
+static bool IsManifestEntryUpToDate(const ManifestEntry& entry)
+{
+	std::error_code ec;
+	auto outTime = fs::last_write_time(entry.outputPath, ec);
+	if (ec)
+		return false;
 
-	File::WriteAllText(outPath.string(), src);
+	auto inTime = fs::last_write_time(entry.inputPath, ec);
+	if (ec)
+		return false;
+
+	return outTime >= inTime;
+}
+
+static void BuildManifestEntry(const ManifestEntry& entry)
+{
+	if (!File::Exists(entry.inputPath.string()))
+	{
+		throw std::runtime_error(StringHelper::Sprintf(
+			"BuildManifestEntry: Error.\n\t Input file '%s' does not exist.\n",
+			entry.inputPath.c_str()));
+	}
+
+	switch (entry.mode)
+	{
+	case ZFileMode::BuildTexture:
+		BuildAssetTexture(entry.inputPath, entry.texType, entry.outputPath);
+		break;
+	case ZFileMode::BuildBackground:
+		BuildAssetBackground(entry.inputPath, entry.outputPath);
+		break;
+	case ZFileMode::BuildBlob:
+		BuildAssetBlob(entry.inputPath, entry.outputPath);
+		break;
+	default:
+		break;
+	}
+}
+
+bool BuildAssetsFromManifest(const fs::path& manifestPath)
+{
+	XMLDocument doc;
+	XMLError eResult = doc.LoadFile(manifestPath.string().c_str());
+
+	if (eResult != tinyxml2::XML_SUCCESS)
+	{
+		fprintf(stderr, "Invalid manifest file: '%s'\n", manifestPath.c_str());
+		return false;
+	}
+
+	XMLNode* root = doc.FirstChild();
+
+	if (root == nullptr)
+	{
+		fprintf(stderr, "Missing Root tag in manifest file: '%s'\n", manifestPath.c_str());
+		return false;
+	}
+
+	std::vector<ManifestEntry> entries;
+
+	for (XMLElement* child = root->FirstChildElement(); child != NULL;
+	     child = child->NextSiblingElement())
+	{
+		std::string nodeName = child->Name();
+		const char* inputPath = child->Attribute("InputPath");
+		const char* outputPath = child->Attribute("OutputPath");
+		ManifestEntry entry;
+
+		if (nodeName == "Texture")
+			entry.mode = ZFileMode::BuildTexture;
+		else if (nodeName == "Background")
+			entry.mode = ZFileMode::BuildBackground;
+		else if (nodeName == "Blob")
+			entry.mode = ZFileMode::BuildBlob;
+		else
+		{
+			throw std::runtime_error(StringHelper::Sprintf(
+				"BuildAssetsFromManifest: Fatal error in '%s'.\n\t Unknown entry type: '%s'\n",
+				manifestPath.c_str(), child->Name()));
+		}
+
+		if (inputPath == nullptr || outputPath == nullptr)
+		{
+			throw std::runtime_error(StringHelper::Sprintf(
+				"BuildAssetsFromManifest: Fatal error in '%s'.\n\t Missing 'InputPath' or "
+				"'OutputPath' in entry of type '%s' (line %i)\n",
+				manifestPath.c_str(), child->Name(), child->GetLineNum()));
+		}
+
+		entry.inputPath = inputPath;
+		entry.outputPath = outputPath;
+
+		if (entry.mode == ZFileMode::BuildTexture)
+		{
+			const char* format = child->Attribute("Format");
+			if (format != nullptr)
+				entry.texType = ZTexture::GetTextureTypeFromString(format);
+
+			if (entry.texType == TextureType::Error)
+			{
+				throw std::runtime_error(StringHelper::Sprintf(
+					"BuildAssetsFromManifest: Fatal error in '%s'.\n\t Missing or invalid "
+					"'Format' in Texture entry '%s'\n",
+					manifestPath.c_str(), inputPath));
+			}
+		}
+
+		if (!IsManifestEntryUpToDate(entry))
+			entries.push_back(entry);
+	}
+
+	// Each worker takes the next pending entry until there are none left. Errors are collected
+	// per entry and reported in manifest order once every worker is done.
+	std::vector<std::string> errors(entries.size());
+	std::atomic<size_t> nextEntry(0);
+
+	auto worker = [&]() {
+		for (size_t i = nextEntry++; i < entries.size(); i = nextEntry++)
+		{
+			try
+			{
+				BuildManifestEntry(entries[i]);
+			}
+			catch (const std::exception& e)
+			{
+				errors[i] = e.what();
+			}
+		}
+	};
+
+	size_t jobs = Globals::Instance->GetWorkerCount(entries.size());
+
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < jobs; i++)
+		workers.emplace_back(worker);
+
+	worker();
+
+	for (std::thread& thread : workers)
+		thread.join();
+
+	bool success = true;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (errors[i] != "")
+		{
+			fprintf(stderr, "Error building '%s':\n%s\n", entries[i].inputPath.c_str(),
+			        errors[i].c_str());
+			success = false;
+		}
+	}
+
+	if (Globals::Instance->verbosity >= VerbosityLevel::VERBOSITY_INFO)
+		printf("Built %zu assets from manifest '%s'\n", entries.size(), manifestPath.c_str());
 
-	delete blob;
+	return success;
 }
 
 void BuildAssetModelIntermediette(const fs::path& outPath)
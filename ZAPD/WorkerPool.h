@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A set of threads which is started once and reused by every parallel step of an extraction, so
+// the steps which run many times (e.g. once per room mesh) don't pay for starting threads each time.
+class WorkerPool
+{
+public:
+	// The calling thread of Run is one of the workers, so only workerCount - 1 threads are started
+	WorkerPool(size_t workerCount)
+	{
+		for (size_t i = 1; i < workerCount; i++)
+			threads.emplace_back(&WorkerPool::WorkerLoop, this);
+	}
+
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+
+		wakeCondition.notify_all();
+
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	size_t GetWorkerCount() const { return threads.size() + 1; }
+
+	// Calls task(i) for every i in [0, taskCount) and returns once all of them are done
+	void Run(size_t taskCount, const std::function<void(size_t)>& task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			currentTask = &task;
+			currentTaskCount = taskCount;
+			nextTask = 0;
+			busyWorkers = threads.size();
+			generation++;
+		}
+
+		wakeCondition.notify_all();
+		RunTasks();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCondition.wait(lock, [this]() { return busyWorkers == 0; });
+		currentTask = nullptr;
+	}
+
+protected:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+	const std::function<void(size_t)>* currentTask = nullptr;
+	size_t currentTaskCount = 0;
+	std::atomic<size_t> nextTask{0};
+	size_t busyWorkers = 0;
+	uint64_t generation = 0;  // Increased by every Run, so each worker joins each one only once
+	bool stopping = false;
+
+	void RunTasks()
+	{
+		for (size_t i = nextTask++; i < currentTaskCount; i = nextTask++)
+			(*currentTask)(i);
+	}
+
+	void WorkerLoop()
+	{
+		uint64_t lastGeneration = 0;
+
+		while (true)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock,
+			                   [&]() { return stopping || generation != lastGeneration; });
+
+			if (stopping)
+				return;
+
+			lastGeneration = generation;
+			lock.unlock();
+
+			RunTasks();
+
+			lock.lock();
+			if (--busyWorkers == 0)
+				doneCondition.notify_one();
+		}
+	}
+};
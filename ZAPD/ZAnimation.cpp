@@ -30,6 +30,7 @@ void ZAnimation::Save(const fs::path& outFolder)
 		HLAnimationIntermediette* anim = HLAnimationIntermediette::FromZAnimation(this);
 		std::string xml = anim->OutputXML();
 		File::WriteAllText(outFolder / (name + ".anmi"), xml);
+		parent->AddOutputFile(outFolder / (name + ".anmi"));
 
 		delete anim;
 	}
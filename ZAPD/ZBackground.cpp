@@ -1,4 +1,5 @@
 #include "ZBackground.h"
+#include <cstring>
 #include "BitConverter.h"
 #include "File.h"
 #include "Globals.h"
@@ -13,6 +14,8 @@ REGISTER_ZFILENODE(Background, ZBackground);
 
 ZBackground::ZBackground(ZFile* nParent) : ZResource(nParent)
 {
+	maxSize = 0;
+	RegisterOptionalAttribute("MaxSize");
 }
 
 ZBackground::ZBackground(const std::string& prefix, uint32_t nRawDataIndex, ZFile* nParent)
@@ -21,29 +24,150 @@ ZBackground::ZBackground(const std::string& prefix, uint32_t nRawDataIndex, ZFil
 	rawDataIndex = nRawDataIndex;
 	name = GetDefaultName(prefix.c_str(), rawDataIndex);
 	outName = name;
+	maxSize = 0;
 
 	ParseRawData();
 }
 
-void ZBackground::ParseRawData()
+void ZBackground::ParseXML(tinyxml2::XMLElement* reader)
 {
-	ZResource::ParseRawData();
+	ZResource::ParseXML(reader);
 
-	const auto& rawData = parent->GetRawData();
-	size_t i = 0;
-	while (true)
+	if (registeredAttributes.at("MaxSize").wasSet)
 	{
-		uint8_t val = rawData.at(rawDataIndex + i);
-		data.push_back(val);
+		maxSize = StringHelper::StrToL(registeredAttributes.at("MaxSize").value, 16);
+
+		if (maxSize == 0 || maxSize > GetRawDataSize())
+			throw std::runtime_error(StringHelper::Sprintf(
+				"ZBackground::ParseXML: Fatal error in '%s'.\n"
+				"\t Invalid value for attribute 'MaxSize': '%s'.\n"
+				"\t It must be bigger than 0 and at most the screen buffer size (0x%zX).\n",
+				name.c_str(), registeredAttributes.at("MaxSize").value.c_str(),
+				GetRawDataSize()));
+	}
+}
 
-		if (BitConverter::ToUInt16BE(rawData, rawDataIndex + i) == 0xFFD9)
-		{
-			data.push_back(rawData.at(rawDataIndex + i + 1));
+// Returns the position of the first 0xFF which is followed by `marker`, or `size` if there's none.
+static size_t FindJpegMarker(const uint8_t* jpeg, size_t pos, size_t size, uint8_t marker)
+{
+	while (pos + 1 < size)
+	{
+		const void* found = memchr(jpeg + pos, 0xFF, size - pos - 1);
+
+		if (found == nullptr)
 			break;
+
+		pos = static_cast<const uint8_t*>(found) - jpeg;
+
+		if (jpeg[pos + 1] == marker)
+			return pos;
+
+		pos++;
+	}
+
+	return size;
+}
+
+// Returns the size of the jpeg starting at `jpeg`, up to and including its EOI marker, by walking
+// its segments. Returns 0 if the data isn't laid out as a jpeg or a segment goes past `size`.
+static size_t WalkJpegSegments(const uint8_t* jpeg, size_t size)
+{
+	if (size < 2 || jpeg[0] != 0xFF || jpeg[1] != 0xD8)
+		return 0;
+
+	// Segments have their length right after the marker, so their contents can be skipped whole
+	// instead of looking for markers in them.
+	size_t pos = 2;
+
+	while (pos + 1 < size && jpeg[pos] == 0xFF)
+	{
+		uint8_t marker = jpeg[pos + 1];
+
+		if (marker == 0xFF)  // Fill byte
+		{
+			pos++;
+			continue;
+		}
+		if (marker == 0xD9)  // EOI
+			return pos + 2;
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))  // No length
+		{
+			pos += 2;
+			continue;
 		}
+		if (pos + 3 >= size)
+			return 0;
+
+		pos += 2 + BitConverter::ToUInt16BE(jpeg, pos + 2);
 
-		i++;
+		if (marker == 0xDA)  // SOS
+		{
+			// The entropy-coded data has no length. It ends at the first marker which isn't a
+			// stuffed 0xFF00 or a restart marker.
+			while (pos + 1 < size)
+			{
+				const void* found = memchr(jpeg + pos, 0xFF, size - pos - 1);
+
+				if (found == nullptr)
+					return 0;
+
+				pos = static_cast<const uint8_t*>(found) - jpeg;
+				uint8_t next = jpeg[pos + 1];
+
+				if (next != 0x00 && (next < 0xD0 || next > 0xD7))
+					break;
+
+				pos += 2;
+			}
+		}
 	}
+
+	return 0;
+}
+
+// Returns the size of the jpeg starting at `jpeg`, up to and including its EOI marker, or 0 if the
+// EOI marker isn't within the first `size` bytes.
+static size_t GetJpegSize(const uint8_t* jpeg, size_t size)
+{
+	size_t jpegSize = WalkJpegSegments(jpeg, size);
+
+	if (jpegSize != 0)
+		return jpegSize;
+
+	// Not laid out as a jpeg or with a broken segment, so just look for the first EOI marker
+	size_t pos = FindJpegMarker(jpeg, 0, size, 0xD9);
+
+	if (pos >= size)
+		return 0;
+
+	return pos + 2;
+}
+
+void ZBackground::ParseRawData()
+{
+	ZResource::ParseRawData();
+
+	const auto& rawData = parent->GetRawData();
+
+	if (rawDataIndex >= rawData.size())
+		throw std::runtime_error(StringHelper::Sprintf(
+			"ZBackground::ParseRawData: Fatal error in '%s'.\n"
+			"\t Offset 0x%06X is outside of file '%s'.\n",
+			name.c_str(), rawDataIndex, parent->GetName().c_str()));
+
+	// A background can't be bigger than the screen buffer it is decoded to
+	size_t limit = maxSize != 0 ? maxSize : GetRawDataSize();
+	limit = std::min(limit, rawData.size() - rawDataIndex);
+
+	size_t jpegSize = GetJpegSize(rawData.data() + rawDataIndex, limit);
+
+	if (jpegSize == 0)
+		throw std::runtime_error(StringHelper::Sprintf(
+			"ZBackground::ParseRawData: Fatal error in '%s'.\n"
+			"\t Couldn't find the end of the jpeg at offset 0x%06X in its first 0x%zX bytes.\n",
+			name.c_str(), rawDataIndex, limit));
+
+	data.assign(rawData.begin() + rawDataIndex, rawData.begin() + rawDataIndex + jpegSize);
 }
 
 void ZBackground::ParseBinaryFile(const std::string& inFolder, bool appendOutName)
@@ -158,6 +282,7 @@ void ZBackground::Save(const fs::path& outFolder)
 {
 	fs::path filepath = outFolder / (outName + "." + GetExternalExtension());
 	File::WriteAllBytes(filepath.string(), data);
+	parent->AddOutputFile(filepath);
 }
 
 std::string ZBackground::GetBodySourceCode()
@@ -8,11 +8,13 @@ class ZBackground : public ZResource
 {
 protected:
 	std::vector<uint8_t> data;
+	size_t maxSize;  // 0 means the screen buffer size
 
 public:
 	ZBackground(ZFile* nParent);
 	ZBackground(const std::string& prefix, uint32_t nRawDataIndex, ZFile* nParent);
 
+	void ParseXML(tinyxml2::XMLElement* reader) override;
 	void ParseRawData() override;
 	void ParseBinaryFile(const std::string& inFolder, bool appendOutName);
 	void ExtractFromXML(tinyxml2::XMLElement* reader, uint32_t nRawDataIndex) override;
@@ -22,7 +22,11 @@ ZBlob* ZBlob::BuildFromXML(XMLElement* reader, const std::string& inFolder, bool
 	blob->ParseXML(reader);
 
 	if (readFile)
-		blob->blobData = File::ReadAllBytes(inFolder + "/" + blob->name + ".bin");
+	{
+		blob->fileData = File::ReadAllBytes(inFolder + "/" + blob->name + ".bin");
+		blob->blobData = blob->fileData.data();
+		blob->blobSize = blob->fileData.size();
+	}
 
 	return blob;
 }
@@ -31,11 +35,47 @@ ZBlob* ZBlob::FromFile(const std::string& filePath)
 {
 	ZBlob* blob = new ZBlob(nullptr);
 	blob->name = StringHelper::Split(Path::GetFileNameWithoutExtension(filePath), ".")[0];
-	blob->blobData = File::ReadAllBytes(filePath);
+	blob->fileData = File::ReadAllBytes(filePath);
+	blob->blobData = blob->fileData.data();
+	blob->blobSize = blob->fileData.size();
 
 	return blob;
 }
 
+// Writes the same code as `GetBodySourceCode`, reading and writing a chunk at a time so big
+// blobs don't have to fit in memory.
+void ZBlob::BuildSourceFile(const fs::path& blobFilePath, const fs::path& outPath)
+{
+	std::ifstream inFile(blobFilePath, std::ios::binary);
+
+	if (!inFile.is_open())
+		throw std::runtime_error(
+			StringHelper::Sprintf("ZBlob::BuildSourceFile: Error.\n"
+		                          "\t Couldn't open blob file '%s'.\n",
+		                          blobFilePath.c_str()));
+
+	std::ofstream outFile(outPath, std::ios::out);
+
+	std::vector<uint8_t> chunk(0x10000);
+	std::string output;
+	size_t index = 0;
+
+	while (inFile.read(reinterpret_cast<char*>(chunk.data()), chunk.size()) ||
+	       inFile.gcount() > 0)
+	{
+		size_t chunkSize = inFile.gcount();
+
+		output.clear();
+		AppendSourceOutput(output, chunk.data(), chunkSize, index);
+		outFile.write(output.data(), output.size());
+
+		index += chunkSize;
+	}
+
+	// Same trailing line feed as `GetBodySourceCode`
+	outFile.write("\n", 1);
+}
+
 void ZBlob::ParseXML(tinyxml2::XMLElement* reader)
 {
 	ZResource::ParseXML(reader);
@@ -45,31 +85,60 @@ void ZBlob::ParseXML(tinyxml2::XMLElement* reader)
 
 void ZBlob::ParseRawData()
 {
-	blobData.assign(parent->GetRawData().begin() + rawDataIndex,
-	                parent->GetRawData().begin() + rawDataIndex + blobSize);
+	const auto& rawData = parent->GetRawData();
+
+	if (rawDataIndex + blobSize > rawData.size())
+		throw std::runtime_error(StringHelper::Sprintf(
+			"ZBlob::ParseRawData: Fatal error in '%s'.\n"
+			"\t Blob of size 0x%zX at offset 0x%06X goes past the end of the file.\n",
+			name.c_str(), blobSize, rawDataIndex));
+
+	// The parent keeps its raw data until it's destroyed, which outlives this blob
+	blobData = rawData.data() + rawDataIndex;
 }
 
-std::string ZBlob::GetSourceOutputCode(const std::string& prefix)
+// Appends the bytes as lines of 16 hex values. `startIndex` is the position of `data` in the whole
+// blob, so the output can be built a chunk at a time.
+void ZBlob::AppendSourceOutput(std::string& output, const uint8_t* data, size_t size,
+                               size_t startIndex)
 {
-	sourceOutput = "";
+	static const char hexDigits[] = "0123456789ABCDEF";
+
+	output.reserve(output.size() + size * 6 + (size / 16 + 1) * 5);
 
-	for (size_t i = 0; i < blobData.size(); i += 1)
+	for (size_t i = 0; i < size; i++)
 	{
-		if (i % 16 == 0)
-			sourceOutput += "    ";
+		size_t index = startIndex + i;
 
-		sourceOutput += StringHelper::Sprintf("0x%02X, ", blobData[i]);
+		if (index % 16 == 0)
+			output += "    ";
 
-		if (i % 16 == 15)
-			sourceOutput += "\n";
+		char hex[] = {'0', 'x', hexDigits[data[i] >> 4], hexDigits[data[i] & 0xF], ',', ' '};
+		output.append(hex, sizeof(hex));
+
+		if (index % 16 == 15)
+			output += "\n";
 	}
+}
+
+std::string ZBlob::GetBodySourceCode() const
+{
+	std::string bodyStr;
+
+	AppendSourceOutput(bodyStr, blobData, blobSize, 0);
 
 	// Ensure there's always a trailing line feed to prevent dumb warnings.
 	// Please don't remove this line, unless you somehow made a way to prevent
 	// that warning when building the OoT repo.
-	sourceOutput += "\n";
+	bodyStr += "\n";
+
+	return bodyStr;
+}
 
-	return sourceOutput;
+std::string ZBlob::GetSourceOutputCode(const std::string& prefix)
+{
+	// The code is built from the extracted .bin file by `bblb`, so the file only includes it
+	return "";
 }
 
 std::string ZBlob::GetSourceOutputHeader(const std::string& prefix)
@@ -79,7 +148,9 @@ std::string ZBlob::GetSourceOutputHeader(const std::string& prefix)
 
 void ZBlob::Save(const fs::path& outFolder)
 {
-	File::WriteAllBytes(outFolder / (name + ".bin"), blobData);
+	File::WriteAllBytes(outFolder / (name + ".bin"), reinterpret_cast<const char*>(blobData),
+	                    blobSize);
+	parent->AddOutputFile(outFolder / (name + ".bin"));
 }
 
 bool ZBlob::IsExternalResource() const
@@ -11,9 +11,11 @@ public:
 	static ZBlob* BuildFromXML(tinyxml2::XMLElement* reader, const std::string& inFolder,
 	                           bool readFile);
 	static ZBlob* FromFile(const std::string& filePath);
+	static void BuildSourceFile(const fs::path& blobFilePath, const fs::path& outPath);
 
 	void ParseXML(tinyxml2::XMLElement* reader) override;
 	void ParseRawData() override;
+	std::string GetBodySourceCode() const override;
 	std::string GetSourceOutputCode(const std::string& prefix) override;
 	std::string GetSourceOutputHeader(const std::string& prefix) override;
 	void Save(const fs::path& outFolder) override;
@@ -26,6 +28,11 @@ public:
 	size_t GetRawDataSize() const override;
 
 protected:
-	std::vector<uint8_t> blobData;
+	// Points into the parent's raw data when extracting, and into `fileData` otherwise
+	const uint8_t* blobData = nullptr;
 	size_t blobSize = 0;
+	std::vector<uint8_t> fileData;
+
+	static void AppendSourceOutput(std::string& output, const uint8_t* data, size_t size,
+	                               size_t startIndex);
 };
@@ -6,11 +6,14 @@
 #include <cassert>
 #include <chrono>
 #include <math.h>
+#include <thread>
+#include <unordered_set>
 #include "BitConverter.h"
 #include "Globals.h"
 #include "HighLevel/HLModelIntermediette.h"
 #include "OutputFormatter.h"
 #include "StringHelper.h"
+#include "WorkerPool.h"
 #include "gfxd.h"
 
 using namespace tinyxml2;
@@ -36,10 +39,6 @@ ZDisplayList::ZDisplayList(ZFile* nParent) : ZResource(nParent)
 
 ZDisplayList::~ZDisplayList()
 {
-	for (auto o : otherDLists)
-	{
-		delete o;
-	}
 }
 
 // EXTRACT MODE
@@ -48,8 +47,8 @@ void ZDisplayList::ExtractFromXML(tinyxml2::XMLElement* reader, uint32_t nRawDat
 	rawDataIndex = nRawDataIndex;
 	ParseXML(reader);
 
-	int32_t rawDataSize = ZDisplayList::GetDListLength(
-		parent->GetRawData(), rawDataIndex,
+	int32_t rawDataSize = parent->GetDListLength(
+		rawDataIndex,
 		Globals::Instance->game == ZGame::OOT_SW97 ? DListType::F3DEX : DListType::F3DZEX);
 	numInstructions = rawDataSize / 8;
 	ParseRawData();
@@ -68,14 +67,17 @@ ZDisplayList::ZDisplayList(uint32_t nRawDataIndex, int32_t rawDataSize, ZFile* n
 
 void ZDisplayList::ParseRawData()
 {
+	auto start = std::chrono::steady_clock::now();
+
 	const auto& rawData = parent->GetRawData();
-	instructions.reserve(numInstructions);
-	uint32_t ptr = rawDataIndex;
+	instructions.resize(numInstructions);
+	BitConverter::ToUInt64BEArray(instructions.data(), rawData.data() + rawDataIndex,
+	                              numInstructions);
 
-	for (size_t i = 0; i < numInstructions; i++)
+	if (Globals::Instance->dlStatsPath != "")
 	{
-		instructions.push_back(BitConverter::ToUInt64BE(rawData, ptr));
-		ptr += 8;
+		auto end = std::chrono::steady_clock::now();
+		stats.parseTime += std::chrono::duration<double, std::milli>(end - start).count();
 	}
 }
 
@@ -85,13 +87,13 @@ Declaration* ZDisplayList::DeclareVar(const std::string& prefix, const std::stri
 	                                   GetSourceTypeName(), name, 0, bodyStr, true);
 }
 
-void ZDisplayList::ParseF3DZEX(F3DZEXOpcode opcode, uint64_t data, int32_t i, std::string prefix,
-                               char* line)
+void ZDisplayList::ParseF3DZEX(F3DZEXOpcode opcode, uint64_t data, int32_t i,
+                               const std::string& prefix, char* line)
 {
 	switch (opcode)
 	{
 	case F3DZEXOpcode::G_NOOP:
-		sprintf(line, "gsDPNoOpTag(0x%08lX),", data & 0xFFFFFFFF);
+		Opcode_G_NOOP(data, line);
 		break;
 	case F3DZEXOpcode::G_DL:
 		Opcode_G_DL(data, prefix, line);
@@ -109,72 +111,17 @@ void ZDisplayList::ParseF3DZEX(F3DZEXOpcode opcode, uint64_t data, int32_t i, st
 		Opcode_G_TRI2(data, line);
 		break;
 	case F3DZEXOpcode::G_QUAD:
-	{
-		int32_t aa = ((data & 0x00FF000000000000ULL) >> 48) / 2;
-		int32_t bb = ((data & 0x0000FF0000000000ULL) >> 40) / 2;
-		int32_t cc = ((data & 0x000000FF00000000ULL) >> 32) / 2;
-		int32_t dd = ((data & 0x000000000000FFULL)) / 2;
-		sprintf(line, "gsSP1Quadrangle(%i, %i, %i, %i, 0),", aa, bb, cc, dd);
-	}
-	break;
+		Opcode_G_QUAD(data, line);
+		break;
 	case F3DZEXOpcode::G_VTX:
 		Opcode_G_VTX(data, line);
 		break;
-	case F3DZEXOpcode::G_SETTIMG:  // HOTSPOT
+	case F3DZEXOpcode::G_SETTIMG:
 		Opcode_G_SETTIMG(data, prefix, line);
 		break;
 	case F3DZEXOpcode::G_GEOMETRYMODE:
-	{
-		int32_t cccccc = (data & 0x00FFFFFF00000000) >> 32;
-		int32_t ssssssss = (data & 0xFFFFFFFF);
-		std::string geoModeStr = "G_TEXTURE_ENABLE";
-
-		int32_t geoModeParam = ~cccccc;
-
-		if (ssssssss != 0)
-			geoModeParam = ssssssss;
-
-		if (geoModeParam & 0x00000001)
-			geoModeStr += " | G_ZBUFFER";
-
-		if (geoModeParam & 0x00000004)
-			geoModeStr += " | G_SHADE";
-
-		if (geoModeParam & 0x00000200)
-			geoModeStr += " | G_CULL_FRONT";
-
-		if (geoModeParam & 0x00000400)
-			geoModeStr += " | G_CULL_BACK";
-
-		if (geoModeParam & 0x00010000)
-			geoModeStr += " | G_FOG";
-
-		if (geoModeParam & 0x00020000)
-			geoModeStr += " | G_LIGHTING";
-
-		if (geoModeParam & 0x00040000)
-			geoModeStr += " | G_TEXTURE_GEN";
-
-		if (geoModeParam & 0x00080000)
-			geoModeStr += " | G_TEXTURE_GEN_LINEAR";
-
-		if (geoModeParam & 0x00200000)
-			geoModeStr += " | G_SHADING_SMOOTH";
-
-		if (geoModeParam & 0x00800000)
-			geoModeStr += " | G_CLIPPING";
-
-		if (ssssssss != 0)
-		{
-			if ((~cccccc & 0xFF000000) != 0)
-				sprintf(line, "gsSPSetGeometryMode(%s),", geoModeStr.c_str());
-			else
-				sprintf(line, "gsSPLoadGeometryMode(%s),", geoModeStr.c_str());
-		}
-		else
-			sprintf(line, "gsSPClearGeometryMode(%s),", geoModeStr.c_str());
-	}
-	break;
+		Opcode_G_GEOMETRYMODE(data, line);
+		break;
 	case F3DZEXOpcode::G_SETPRIMCOLOR:
 		Opcode_G_SETPRIMCOLOR(data, line);
 		break;
@@ -197,36 +144,20 @@ void ZDisplayList::ParseF3DZEX(F3DZEXOpcode opcode, uint64_t data, int32_t i, st
 		Opcode_G_TEXTURE(data, line);
 		break;
 	case F3DZEXOpcode::G_RDPSETOTHERMODE:
-	{
-		int32_t hhhhhh = (data & 0x00FFFFFF00000000) >> 32;
-		int32_t llllllll = (data & 0x00000000FFFFFFFF);
-
-		sprintf(line, "gsDPSetOtherMode(%i, %i),", hhhhhh, llllllll);
-	}
-	break;
+		Opcode_G_RDPSETOTHERMODE(data, line);
+		break;
 	case F3DZEXOpcode::G_POPMTX:
-	{
-		sprintf(line, "gsSPPopMatrix(%li),", data);
-	}
-	break;
+		Opcode_G_POPMTX(data, line);
+		break;
 	case F3DZEXOpcode::G_LOADTLUT:
 		Opcode_G_LOADTLUT(data, prefix, line);
 		break;
 	case F3DZEXOpcode::G_SETENVCOLOR:
-	{
-		uint8_t r = (uint8_t)((data & 0xFF000000) >> 24);
-		uint8_t g = (uint8_t)((data & 0x00FF0000) >> 16);
-		uint8_t b = (uint8_t)((data & 0xFF00FF00) >> 8);
-		uint8_t a = (uint8_t)((data & 0x000000FF) >> 0);
-
-		sprintf(line, "gsDPSetEnvColor(%i, %i, %i, %i),", r, g, b, a);
-	}
-	break;
+		Opcode_G_SETENVCOLOR(data, line);
+		break;
 	case F3DZEXOpcode::G_SETCOMBINE:
-	{
 		Opcode_G_SETCOMBINE(data, line);
-	}
-	break;
+		break;
 	case F3DZEXOpcode::G_RDPLOADSYNC:
 		sprintf(line, "gsDPLoadSync(),");
 		break;
@@ -243,31 +174,8 @@ void ZDisplayList::ParseF3DZEX(F3DZEXOpcode opcode, uint64_t data, int32_t i, st
 		Opcode_G_ENDDL(prefix, line);
 		break;
 	case F3DZEXOpcode::G_RDPHALF_1:
-	{
-		uint64_t data2 = instructions[i + 1];
-		uint32_t h = (data & 0xFFFFFFFF);
-		F3DZEXOpcode opcode2 = (F3DZEXOpcode)(instructions[i + 1] >> 56);
-
-		if (opcode2 == F3DZEXOpcode::G_BRANCH_Z)
-		{
-			uint32_t a = (data2 & 0x00FFF00000000000) >> 44;
-			uint32_t b = (data2 & 0x00000FFF00000000) >> 32;
-			uint32_t z = (data2 & 0x00000000FFFFFFFF) >> 0;
-
-			// sprintf(line, "gsDPWord(%i, 0),", h);
-			sprintf(line, "gsSPBranchLessZraw(%sDlist0x%06X, 0x%02X, 0x%02X),", prefix.c_str(),
-			        h & 0x00FFFFFF, (a / 5) | (b / 2), z);
-
-			ZDisplayList* nList = new ZDisplayList(
-				h & 0x00FFFFFF, GetDListLength(parent->GetRawData(), h & 0x00FFFFFF, dListType),
-				parent);
-			nList->scene = scene;
-			otherDLists.push_back(nList);
-
-			i++;
-		}
-	}
-	break;
+		Opcode_G_RDPHALF_1(data, i, prefix, line);
+		break;
 	case F3DZEXOpcode::G_MTX:
 		Opcode_G_MTX(data, line);
 		break;
@@ -277,12 +185,13 @@ void ZDisplayList::ParseF3DZEX(F3DZEXOpcode opcode, uint64_t data, int32_t i, st
 	}
 }
 
-void ZDisplayList::ParseF3DEX(F3DEXOpcode opcode, uint64_t data, std::string prefix, char* line)
+void ZDisplayList::ParseF3DEX(F3DEXOpcode opcode, uint64_t data, const std::string& prefix,
+                              char* line)
 {
 	switch (opcode)
 	{
 	case F3DEXOpcode::G_NOOP:
-		sprintf(line, "gsDPNoOpTag(0x%08lX),", data & 0xFFFFFFFF);
+		Opcode_G_NOOP(data, line);
 		break;
 	case F3DEXOpcode::G_VTX:
 		Opcode_G_VTX(data, line);
@@ -351,320 +260,461 @@ void ZDisplayList::ParseF3DEX(F3DEXOpcode opcode, uint64_t data, std::string pre
 		Opcode_G_LOADTLUT(data, prefix, line);
 		break;
 	case F3DEXOpcode::G_CLEARGEOMETRYMODE:
+		Opcode_F3DEX_G_GEOMETRYMODE(data, false, line);
+		break;
 	case F3DEXOpcode::G_SETGEOMETRYMODE:
-	{
-		int32_t cccccc = (data & 0x00FFFFFF00000000) >> 32;
-		int32_t ssssssss = (data & 0xFFFFFFFF);
-		std::string geoModeStr = "G_TEXTURE_ENABLE";
-
-		int32_t geoModeParam = ~cccccc;
-
-		if (ssssssss != 0)
-			geoModeParam = ssssssss;
+		Opcode_F3DEX_G_GEOMETRYMODE(data, true, line);
+		break;
+	default:
+		sprintf(line, "// Opcode 0x%02X unimplemented!", (uint32_t)opcode);
+		break;
+	}
+}
 
-		if (geoModeParam & 0x00000002)
-			geoModeStr += " | G_TEXTURE_ENABLE";
+void ZDisplayList::ParseInstruction(uint64_t data, int32_t i, const std::string& prefix,
+                                    char* line)
+{
+	uint8_t opcode = (uint8_t)(data >> 56);
 
-		if (geoModeParam & 0x00000200)
-			geoModeStr += " | G_SHADING_SMOOTH";
+	if (dListType == DListType::F3DZEX)
+		ParseF3DZEX((F3DZEXOpcode)opcode, data, i, prefix, line);
+	else
+		ParseF3DEX((F3DEXOpcode)opcode, data, prefix, line);
+}
 
-		if (geoModeParam & 0x00001000)
-			geoModeStr += " | G_CULL_FRONT";
+// gsDPLoadTextureBlock, gsDPLoadMultiBlock and their _4b variants share the same sequence,
+// OptimizationCheck_LoadTextureBlock tells them apart from the instruction parameters.
+const std::vector<ZDisplayList::MacroPattern> ZDisplayList::macroPatterns = {
+	{{F3DZEXOpcode::G_SETTIMG, F3DZEXOpcode::G_SETTILE, F3DZEXOpcode::G_RDPLOADSYNC,
+      F3DZEXOpcode::G_LOADBLOCK, F3DZEXOpcode::G_RDPPIPESYNC, F3DZEXOpcode::G_SETTILE,
+      F3DZEXOpcode::G_SETTILESIZE},
+     &ZDisplayList::OptimizationCheck_LoadTextureBlock},
+};
 
-		if (geoModeParam & 0x00002000)
-			geoModeStr += " | G_CULL_BACK";
+ZDisplayList::MacroAutomaton::MacroAutomaton(const std::vector<MacroPattern>& patterns)
+{
+	std::array<int32_t, 256> noTransitions;
+	noTransitions.fill(-1);
 
-		if (geoModeParam & 0x00000001)
-			geoModeStr += " | G_ZBUFFER";
+	// Build the trie of all the sequences
+	transitions.push_back(noTransitions);
+	matches.emplace_back();
 
-		if (geoModeParam & 0x00000004)
-			geoModeStr += " | G_SHADE";
+	for (size_t i = 0; i < patterns.size(); i++)
+	{
+		int32_t state = 0;
 
-		if (geoModeParam & 0x00010000)
-			geoModeStr += " | G_FOG";
+		for (F3DZEXOpcode opcode : patterns[i].sequence)
+		{
+			int32_t& next = transitions[state][static_cast<uint8_t>(opcode)];
 
-		if (geoModeParam & 0x00020000)
-			geoModeStr += " | G_LIGHTING";
+			if (next == -1)
+			{
+				next = transitions.size();
+				transitions.push_back(noTransitions);
+				matches.emplace_back();
+			}
 
-		if (geoModeParam & 0x00040000)
-			geoModeStr += " | G_TEXTURE_GEN";
+			state = transitions[state][static_cast<uint8_t>(opcode)];
+		}
 
-		if (geoModeParam & 0x00080000)
-			geoModeStr += " | G_TEXTURE_GEN_LINEAR";
+		matches[state].push_back(i);
+	}
 
-		if (geoModeParam & 0x00800000)
-			geoModeStr += " | G_CLIPPING";
+	// Turn it into a full automaton by following the failure links breadth first
+	std::vector<int32_t> failure(transitions.size(), 0);
+	std::vector<int32_t> queue;
 
-		if (opcode == F3DEXOpcode::G_SETGEOMETRYMODE)
-			sprintf(line, "gsSPSetGeometryMode(%s),", geoModeStr.c_str());
+	for (int32_t& next : transitions[0])
+	{
+		if (next == -1)
+			next = 0;
 		else
-			sprintf(line, "gsSPClearGeometryMode(%s),", geoModeStr.c_str());
-	}
-	break;
-	default:
-		sprintf(line, "// Opcode 0x%02X unimplemented!", (uint32_t)opcode);
-		break;
+			queue.push_back(next);
 	}
-}
-
-int32_t ZDisplayList::GetDListLength(const std::vector<uint8_t>& rawData, uint32_t rawDataIndex,
-                                     DListType dListType)
-{
-	uint8_t endDLOpcode;
-
-	if (dListType == DListType::F3DZEX)
-		endDLOpcode = (uint8_t)F3DZEXOpcode::G_ENDDL;
-	else
-		endDLOpcode = (uint8_t)F3DEXOpcode::G_ENDDL;
 
-	uint32_t ptr = rawDataIndex;
-	size_t rawDataSize = rawData.size();
-	while (true)
+	for (size_t i = 0; i < queue.size(); i++)
 	{
-		if (ptr > rawDataSize)
-		{
-			throw std::runtime_error(
-				StringHelper::Sprintf("%s: Fatal error.\n"
-			                          "\t End of file found when trying to find the end of the "
-			                          "DisplayList at offset: '0x%X'.\n",
-			                          __PRETTY_FUNCTION__, rawDataIndex));
-			throw std::runtime_error("");
-		}
+		int32_t state = queue[i];
+		const std::vector<int32_t>& failureMatches = matches[failure[state]];
+		matches[state].insert(matches[state].end(), failureMatches.begin(), failureMatches.end());
 
-		uint8_t opcode = rawData.at(ptr);
-		ptr += 8;
+		for (size_t opcode = 0; opcode < 256; opcode++)
+		{
+			int32_t next = transitions[state][opcode];
 
-		if (opcode == endDLOpcode)
-			return ptr - rawDataIndex;
+			if (next == -1)
+				transitions[state][opcode] = transitions[failure[state]][opcode];
+			else
+			{
+				failure[next] = transitions[failure[state]][opcode];
+				queue.push_back(next);
+			}
+		}
 	}
 }
 
-bool ZDisplayList::SequenceCheck(std::vector<F3DZEXOpcode> sequence, int32_t startIndex)
+// Returns the index in macroPatterns of the longest pattern starting at each instruction, or -1.
+std::vector<int32_t> ZDisplayList::FindMacroPatterns() const
 {
-	bool success = true;
+	static const MacroAutomaton automaton(macroPatterns);
+	std::vector<int32_t> result(instructions.size(), -1);
+	int32_t state = 0;
 
-	for (size_t j = 0; j < sequence.size(); j++)
+	for (size_t i = 0; i < instructions.size(); i++)
 	{
-		F3DZEXOpcode opcode = (F3DZEXOpcode)(instructions[startIndex + j] >> 56);
+		state = automaton.transitions[state][instructions[i] >> 56];
 
-		if (sequence[j] != opcode)
+		for (int32_t patternIndex : automaton.matches[state])
 		{
-			success = false;
-			break;
+			size_t patternSize = macroPatterns[patternIndex].sequence.size();
+			int32_t& startMatch = result[i + 1 - patternSize];
+
+			if (startMatch == -1 || macroPatterns[startMatch].sequence.size() < patternSize)
+				startMatch = patternIndex;
 		}
 	}
 
-	if (success)
-		return true;
-
-	return false;
+	return result;
 }
 
-int32_t ZDisplayList::OptimizationChecks(int32_t startIndex, std::string& output,
-                                         std::string prefix)
+int32_t ZDisplayList::OptimizationCheck_LoadTextureBlock(int32_t startIndex, std::string& output,
+                                                         const std::string& prefix)
 {
-	int32_t result = -1;
+	// gsDPLoadTextureBlock(texAddr, fmt, siz, width, height, pal, cms, cmt, masks, maskt,
+	// shifts, shiftt) gsDPLoadMultiBlock(texAddr, tmem, rtile, fmt, siz, width, height, pal,
+	// cms, cmt, masks, maskt, shifts, shiftt) gsDPLoadTextureBlock_4b(texAddr, fmt, width,
+	// height, pal, cms, cmt, masks, maskt, shifts, shiftt) gsDPLoadMultiBlock_4b(texAddr, tmem,
+	// rtile, fmt, width, height, pal, cms, cmt, masks, maskt, shifts, shiftt)
 
-	result = OptimizationCheck_LoadTextureBlock(startIndex, output, prefix);
+	uint32_t texAddr, tmem, rtile, fmt, siz, sizB, width, height, width2, height2, pal, cms,
+		cmt, masks, maskt, shifts, shiftt;
+	std::string texStr = "";
 
-	if (result != -1)
-		return result;
+	// gsDPSetTextureImage
+	{
+		uint64_t data = instructions[startIndex + 0];
 
-	return -1;
-}
+		int32_t __ = (data & 0x00FF000000000000) >> 48;
+		// int32_t www = (data & 0x00000FFF00000000) >> 32;
 
-int32_t ZDisplayList::OptimizationCheck_LoadTextureBlock(int32_t startIndex, std::string& output,
-                                                         std::string prefix)
-{
-	if (scene == nullptr)
+		fmt = (__ & 0xE0) >> 5;
+		siz = (__ & 0x18) >> 3;
+		texAddr = Seg2Filespace(data, parent->baseAddress);
+		int32_t segmentNumber = GETSEGNUM(data);
+
+		lastTexSeg = segmentNumber;
+
+		ZFile* auxParent = parent;
+		if (parent->segment != segmentNumber && Globals::Instance->HasSegment(segmentNumber))
+			auxParent = Globals::Instance->segmentRefFiles.at(segmentNumber);
+
+		Declaration* decl = auxParent->GetDeclaration(texAddr);
+		if (Globals::Instance->HasSegment(segmentNumber) && decl != nullptr)
+			texStr = decl->varName;
+		else if (lastTexture != nullptr)
+			texStr = lastTexture->GetName();
+		else
+			texStr = auxParent->GetDeclarationPtrName(data & 0xFFFFFFFF);
+	}
+
+	// gsDPSetTile
 	{
-		return -1;
+		uint64_t data = instructions[startIndex + 1];
+
+		tmem =
+			(data & 0b0000000000000000111111111111111100000000000000000000000000000000) >> 32;
+
+		cmt = (data & 0b0000000000000000000000000000000000000000000011000000000000000000) >> 18;
+		maskt =
+			(data & 0b0000000000000000000000000000000000000000000000111100000000000000) >> 14;
+		shiftt =
+			(data & 0b0000000000000000000000000000000000000000000000000011110000000000) >> 10;
+		cms = (data & 0b0000000000000000000000000000000000000000000000000000001100000000) >> 8;
+		masks =
+			(data & 0b0000000000000000000000000000000000000000000000000000000011110000) >> 4;
+		shifts = (data & 0b0000000000000000000000000000000000000000000000000000000000001111);
+
+		// sprintf(line, "gsDPSetTile(%s, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
+		// fmtTbl[fff].c_str(), sizTbl[ii].c_str(), nnnnnnnnn, mmmmmmmmm, ttt, pppp, cc, aaaa,
+		// ssss, dd, bbbb, uuuu);
 	}
 
-	std::vector<F3DZEXOpcode> sequence = {F3DZEXOpcode::G_SETTIMG,     F3DZEXOpcode::G_SETTILE,
-	                                      F3DZEXOpcode::G_RDPLOADSYNC, F3DZEXOpcode::G_LOADBLOCK,
-	                                      F3DZEXOpcode::G_RDPPIPESYNC, F3DZEXOpcode::G_SETTILE,
-	                                      F3DZEXOpcode::G_SETTILESIZE};
+	// gsDPLoadSync
+
+	// gsDPLoadBlock
 
-	bool seqRes = SequenceCheck(sequence, startIndex);
+	// gsDPPipeSync
 
-	if (seqRes)
+	// gsDPSetTile
 	{
-		// gsDPLoadTextureBlock(texAddr, fmt, siz, width, height, pal, cms, cmt, masks, maskt,
-		// shifts, shiftt) gsDPLoadMultiBlock(texAddr, tmem, rtile, fmt, siz, width, height, pal,
-		// cms, cmt, masks, maskt, shifts, shiftt) gsDPLoadTextureBlock_4b(texAddr, fmt, width,
-		// height, pal, cms, cmt, masks, maskt, shifts, shiftt) gsDPLoadMultiBlock_4b(texAddr, tmem,
-		// rtile, fmt, width, height, pal, cms, cmt, masks, maskt, shifts, shiftt)
+		uint64_t data = instructions[startIndex + 5];
+		int32_t __ = (data & 0x00FF000000000000) >> 48;
+		pal = (data & 0b0000000000000000000000000000000000000000111100000000000000000000) >> 20;
+		// siz = (__ & 0x18) >> 3;
+		rtile =
+			(data & 0b0000000000000000000000000000000011111111000000000000000000000000) >> 24;
+		sizB = (__ & 0x18) >> 3;
+	}
 
-		uint32_t texAddr, tmem, rtile, fmt, siz, sizB, width, height, width2, height2, pal, cms,
-			cmt, masks, maskt, shifts, shiftt;
-		std::string texStr = "";
+	// gsDPSetTileSize
+	{
+		uint64_t data = instructions[startIndex + 6];
+		int32_t uuu = (data & 0x0000000000FFF000) >> 12;
+		int32_t vvv = (data & 0x0000000000000FFF);
 
-		// gsDPSetTextureImage
-		{
-			uint64_t data = instructions[startIndex + 0];
+		int32_t shiftAmtW = 2;
+		int32_t shiftAmtH = 2;
 
-			int32_t __ = (data & 0x00FF000000000000) >> 48;
-			// int32_t www = (data & 0x00000FFF00000000) >> 32;
+		if (sizB == (int32_t)F3DZEXTexSizes::G_IM_SIZ_8b &&
+		    fmt == (int32_t)F3DZEXTexFormats::G_IM_FMT_IA)
+			shiftAmtW = 3;
 
-			fmt = (__ & 0xE0) >> 5;
-			siz = (__ & 0x18) >> 3;
-			texAddr = Seg2Filespace(data, parent->baseAddress);
-			int32_t segmentNumber = GETSEGNUM(data);
+		if (sizB == (int32_t)F3DZEXTexSizes::G_IM_SIZ_4b)
+			shiftAmtW = 3;
 
-			lastTexSeg = segmentNumber;
+		if (sizB == (int32_t)F3DZEXTexSizes::G_IM_SIZ_4b &&
+		    fmt == (int32_t)F3DZEXTexFormats::G_IM_FMT_IA)
+			shiftAmtH = 3;
 
-			ZFile* auxParent = parent;
-			if (parent->segment != segmentNumber && Globals::Instance->HasSegment(segmentNumber))
-				auxParent = Globals::Instance->segmentRefFiles.at(segmentNumber);
+		width = (uuu >> shiftAmtW) + 1;
+		height = (vvv >> shiftAmtH) + 1;
 
-			Declaration* decl = auxParent->GetDeclaration(texAddr);
-			if (Globals::Instance->HasSegment(segmentNumber) && decl != nullptr)
-				texStr = decl->varName;
-			else if (lastTexture != nullptr)
-				texStr = lastTexture->GetName();
-			else
-				texStr = auxParent->GetDeclarationPtrName(data & 0xFFFFFFFF);
-		}
+		width2 = (uuu >> 2) + 1;
+		height2 = (vvv >> 2) + 1;
+	}
+
+	std::string fmtTbl[] = {"G_IM_FMT_RGBA", "G_IM_FMT_YUV", "G_IM_FMT_CI", "G_IM_FMT_IA",
+	                        "G_IM_FMT_I"};
+	std::string sizTbl[] = {"G_IM_SIZ_4b", "G_IM_SIZ_8b", "G_IM_SIZ_16b", "G_IM_SIZ_32b"};
 
-		// gsDPSetTile
+	// output += StringHelper::Sprintf("gsDPLoadTextureBlock(%s, %s, %s, %i, %i, %i, %i, %i, %i,
+	// %i, %i, %i),", texStr.c_str(), fmtTbl[fmt].c_str(), sizTbl[siz].c_str(), width, height,
+	// pal, cms, cmt, masks, maskt, shifts, shiftt);
+
+	if (siz == 2 && sizB == 0)
+	{
+		if (tmem != 0)
+			output += StringHelper::Sprintf(
+				"gsDPLoadMultiBlock_4b(%s, %i, %i, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
+				texStr.c_str(), tmem, rtile, fmtTbl[fmt].c_str(), width2, height2, pal, cms,
+				cmt, masks, maskt, shifts, shiftt);
+		else
+			output += StringHelper::Sprintf(
+				"gsDPLoadTextureBlock_4b(%s, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
+				texStr.c_str(), fmtTbl[fmt].c_str(), width2, height2, pal, cms, cmt, masks,
+				maskt, shifts, shiftt);
+	}
+	else if (siz == 2 && sizB != 0)
+	{
+		if (tmem != 0)
+			output += StringHelper::Sprintf(
+				"gsDPLoadMultiBlock(%s, %i, %i, %s, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
+				texStr.c_str(), tmem, rtile, fmtTbl[fmt].c_str(), sizTbl[sizB].c_str(), width2,
+				height2, pal, cms, cmt, masks, maskt, shifts, shiftt);
+		else
+			output += StringHelper::Sprintf(
+				"gsDPLoadTextureBlock(%s, %s, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
+				texStr.c_str(), fmtTbl[fmt].c_str(), sizTbl[sizB].c_str(), width2, height2, pal,
+				cms, cmt, masks, maskt, shifts, shiftt);
+	}
+	else
+	{
+		if (siz != sizB)
 		{
-			uint64_t data = instructions[startIndex + 1];
-
-			tmem =
-				(data & 0b0000000000000000111111111111111100000000000000000000000000000000) >> 32;
-
-			cmt = (data & 0b0000000000000000000000000000000000000000000011000000000000000000) >> 18;
-			maskt =
-				(data & 0b0000000000000000000000000000000000000000000000111100000000000000) >> 14;
-			shiftt =
-				(data & 0b0000000000000000000000000000000000000000000000000011110000000000) >> 10;
-			cms = (data & 0b0000000000000000000000000000000000000000000000000000001100000000) >> 8;
-			masks =
-				(data & 0b0000000000000000000000000000000000000000000000000000000011110000) >> 4;
-			shifts = (data & 0b0000000000000000000000000000000000000000000000000000000000001111);
-
-			// sprintf(line, "gsDPSetTile(%s, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
-			// fmtTbl[fff].c_str(), sizTbl[ii].c_str(), nnnnnnnnn, mmmmmmmmm, ttt, pppp, cc, aaaa,
-			// ssss, dd, bbbb, uuuu);
+			lastTexAddr = texAddr;
+			lastTexFmt = (F3DZEXTexFormats)fmt;
+			lastTexWidth = width;
+			lastTexHeight = height;
+			lastTexSiz = (F3DZEXTexSizes)siz;
+			lastTexLoaded = true;
+
+			TextureGenCheck(prefix);
+
+			return -1;
 		}
 
-		// gsDPLoadSync
+		output += StringHelper::Sprintf(
+			"gsDPLoadMultiBlock(%s, %i, %i, %s, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
+			texStr.c_str(), tmem, rtile, fmtTbl[fmt].c_str(), sizTbl[siz].c_str(), width,
+			height, pal, cms, cmt, masks, maskt, shifts, shiftt);
+	}
 
-		// gsDPLoadBlock
+	lastTexAddr = texAddr;
+	lastTexFmt = (F3DZEXTexFormats)fmt;
+	lastTexWidth = width;
+	lastTexHeight = height;
+	lastTexSiz = (F3DZEXTexSizes)siz;
+	lastTexLoaded = true;
 
-		// gsDPPipeSync
+	TextureGenCheck(prefix);
 
-		// gsDPSetTile
-		{
-			uint64_t data = instructions[startIndex + 5];
-			int32_t __ = (data & 0x00FF000000000000) >> 48;
-			pal = (data & 0b0000000000000000000000000000000000000000111100000000000000000000) >> 20;
-			// siz = (__ & 0x18) >> 3;
-			rtile =
-				(data & 0b0000000000000000000000000000000011111111000000000000000000000000) >> 24;
-			sizB = (__ & 0x18) >> 3;
-		}
+	return 7;  // Instructions replaced by the macro
+}
 
-		// gsDPSetTileSize
-		{
-			uint64_t data = instructions[startIndex + 6];
-			int32_t uuu = (data & 0x0000000000FFF000) >> 12;
-			int32_t vvv = (data & 0x0000000000000FFF);
+void ZDisplayList::Opcode_G_NOOP(uint64_t data, char* line)
+{
+	sprintf(line, "gsDPNoOpTag(0x%08lX),", data & 0xFFFFFFFF);
+}
 
-			int32_t shiftAmtW = 2;
-			int32_t shiftAmtH = 2;
+void ZDisplayList::Opcode_G_QUAD(uint64_t data, char* line)
+{
+	int32_t aa = ((data & 0x00FF000000000000ULL) >> 48) / 2;
+	int32_t bb = ((data & 0x0000FF0000000000ULL) >> 40) / 2;
+	int32_t cc = ((data & 0x000000FF00000000ULL) >> 32) / 2;
+	int32_t dd = ((data & 0x000000000000FFULL)) / 2;
+	sprintf(line, "gsSP1Quadrangle(%i, %i, %i, %i, 0),", aa, bb, cc, dd);
+}
 
-			if (sizB == (int32_t)F3DZEXTexSizes::G_IM_SIZ_8b &&
-			    fmt == (int32_t)F3DZEXTexFormats::G_IM_FMT_IA)
-				shiftAmtW = 3;
+void ZDisplayList::Opcode_G_GEOMETRYMODE(uint64_t data, char* line)
+{
+	int32_t cccccc = (data & 0x00FFFFFF00000000) >> 32;
+	int32_t ssssssss = (data & 0xFFFFFFFF);
+	std::string geoModeStr = "G_TEXTURE_ENABLE";
 
-			if (sizB == (int32_t)F3DZEXTexSizes::G_IM_SIZ_4b)
-				shiftAmtW = 3;
+	int32_t geoModeParam = ~cccccc;
 
-			if (sizB == (int32_t)F3DZEXTexSizes::G_IM_SIZ_4b &&
-			    fmt == (int32_t)F3DZEXTexFormats::G_IM_FMT_IA)
-				shiftAmtH = 3;
+	if (ssssssss != 0)
+		geoModeParam = ssssssss;
 
-			width = (uuu >> shiftAmtW) + 1;
-			height = (vvv >> shiftAmtH) + 1;
+	if (geoModeParam & 0x00000001)
+		geoModeStr += " | G_ZBUFFER";
 
-			width2 = (uuu >> 2) + 1;
-			height2 = (vvv >> 2) + 1;
-		}
+	if (geoModeParam & 0x00000004)
+		geoModeStr += " | G_SHADE";
 
-		std::string fmtTbl[] = {"G_IM_FMT_RGBA", "G_IM_FMT_YUV", "G_IM_FMT_CI", "G_IM_FMT_IA",
-		                        "G_IM_FMT_I"};
-		std::string sizTbl[] = {"G_IM_SIZ_4b", "G_IM_SIZ_8b", "G_IM_SIZ_16b", "G_IM_SIZ_32b"};
+	if (geoModeParam & 0x00000200)
+		geoModeStr += " | G_CULL_FRONT";
 
-		// output += StringHelper::Sprintf("gsDPLoadTextureBlock(%s, %s, %s, %i, %i, %i, %i, %i, %i,
-		// %i, %i, %i),", texStr.c_str(), fmtTbl[fmt].c_str(), sizTbl[siz].c_str(), width, height,
-		// pal, cms, cmt, masks, maskt, shifts, shiftt);
+	if (geoModeParam & 0x00000400)
+		geoModeStr += " | G_CULL_BACK";
 
-		if (siz == 2 && sizB == 0)
-		{
-			if (tmem != 0)
-				output += StringHelper::Sprintf(
-					"gsDPLoadMultiBlock_4b(%s, %i, %i, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
-					texStr.c_str(), tmem, rtile, fmtTbl[fmt].c_str(), width2, height2, pal, cms,
-					cmt, masks, maskt, shifts, shiftt);
-			else
-				output += StringHelper::Sprintf(
-					"gsDPLoadTextureBlock_4b(%s, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
-					texStr.c_str(), fmtTbl[fmt].c_str(), width2, height2, pal, cms, cmt, masks,
-					maskt, shifts, shiftt);
-		}
-		else if (siz == 2 && sizB != 0)
-		{
-			if (tmem != 0)
-				output += StringHelper::Sprintf(
-					"gsDPLoadMultiBlock(%s, %i, %i, %s, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
-					texStr.c_str(), tmem, rtile, fmtTbl[fmt].c_str(), sizTbl[sizB].c_str(), width2,
-					height2, pal, cms, cmt, masks, maskt, shifts, shiftt);
-			else
-				output += StringHelper::Sprintf(
-					"gsDPLoadTextureBlock(%s, %s, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
-					texStr.c_str(), fmtTbl[fmt].c_str(), sizTbl[sizB].c_str(), width2, height2, pal,
-					cms, cmt, masks, maskt, shifts, shiftt);
-		}
-		else
-		{
-			if (siz != sizB)
-			{
-				lastTexAddr = texAddr;
-				lastTexFmt = (F3DZEXTexFormats)fmt;
-				lastTexWidth = width;
-				lastTexHeight = height;
-				lastTexSiz = (F3DZEXTexSizes)siz;
-				lastTexLoaded = true;
+	if (geoModeParam & 0x00010000)
+		geoModeStr += " | G_FOG";
 
-				TextureGenCheck(prefix);
+	if (geoModeParam & 0x00020000)
+		geoModeStr += " | G_LIGHTING";
 
-				return -1;
-			}
+	if (geoModeParam & 0x00040000)
+		geoModeStr += " | G_TEXTURE_GEN";
 
-			output += StringHelper::Sprintf(
-				"gsDPLoadMultiBlock(%s, %i, %i, %s, %s, %i, %i, %i, %i, %i, %i, %i, %i, %i),",
-				texStr.c_str(), tmem, rtile, fmtTbl[fmt].c_str(), sizTbl[siz].c_str(), width,
-				height, pal, cms, cmt, masks, maskt, shifts, shiftt);
-		}
+	if (geoModeParam & 0x00080000)
+		geoModeStr += " | G_TEXTURE_GEN_LINEAR";
 
-		lastTexAddr = texAddr;
-		lastTexFmt = (F3DZEXTexFormats)fmt;
-		lastTexWidth = width;
-		lastTexHeight = height;
-		lastTexSiz = (F3DZEXTexSizes)siz;
-		lastTexLoaded = true;
+	if (geoModeParam & 0x00200000)
+		geoModeStr += " | G_SHADING_SMOOTH";
 
-		TextureGenCheck(prefix);
+	if (geoModeParam & 0x00800000)
+		geoModeStr += " | G_CLIPPING";
 
-		return (int32_t)sequence.size();
+	if (ssssssss != 0)
+	{
+		if ((~cccccc & 0xFF000000) != 0)
+			sprintf(line, "gsSPSetGeometryMode(%s),", geoModeStr.c_str());
+		else
+			sprintf(line, "gsSPLoadGeometryMode(%s),", geoModeStr.c_str());
 	}
+	else
+		sprintf(line, "gsSPClearGeometryMode(%s),", geoModeStr.c_str());
+}
+
+void ZDisplayList::Opcode_F3DEX_G_GEOMETRYMODE(uint64_t data, bool isSet, char* line)
+{
+	int32_t cccccc = (data & 0x00FFFFFF00000000) >> 32;
+	int32_t ssssssss = (data & 0xFFFFFFFF);
+	std::string geoModeStr = "G_TEXTURE_ENABLE";
+
+	int32_t geoModeParam = ~cccccc;
+
+	if (ssssssss != 0)
+		geoModeParam = ssssssss;
+
+	if (geoModeParam & 0x00000002)
+		geoModeStr += " | G_TEXTURE_ENABLE";
+
+	if (geoModeParam & 0x00000200)
+		geoModeStr += " | G_SHADING_SMOOTH";
+
+	if (geoModeParam & 0x00001000)
+		geoModeStr += " | G_CULL_FRONT";
+
+	if (geoModeParam & 0x00002000)
+		geoModeStr += " | G_CULL_BACK";
+
+	if (geoModeParam & 0x00000001)
+		geoModeStr += " | G_ZBUFFER";
+
+	if (geoModeParam & 0x00000004)
+		geoModeStr += " | G_SHADE";
+
+	if (geoModeParam & 0x00010000)
+		geoModeStr += " | G_FOG";
+
+	if (geoModeParam & 0x00020000)
+		geoModeStr += " | G_LIGHTING";
+
+	if (geoModeParam & 0x00040000)
+		geoModeStr += " | G_TEXTURE_GEN";
+
+	if (geoModeParam & 0x00080000)
+		geoModeStr += " | G_TEXTURE_GEN_LINEAR";
+
+	if (geoModeParam & 0x00800000)
+		geoModeStr += " | G_CLIPPING";
+
+	if (isSet)
+		sprintf(line, "gsSPSetGeometryMode(%s),", geoModeStr.c_str());
+	else
+		sprintf(line, "gsSPClearGeometryMode(%s),", geoModeStr.c_str());
+}
 
-	return -1;
+void ZDisplayList::Opcode_G_RDPSETOTHERMODE(uint64_t data, char* line)
+{
+	int32_t hhhhhh = (data & 0x00FFFFFF00000000) >> 32;
+	int32_t llllllll = (data & 0x00000000FFFFFFFF);
+
+	sprintf(line, "gsDPSetOtherMode(%i, %i),", hhhhhh, llllllll);
+}
+
+void ZDisplayList::Opcode_G_POPMTX(uint64_t data, char* line)
+{
+	sprintf(line, "gsSPPopMatrix(%li),", data);
+}
+
+void ZDisplayList::Opcode_G_SETENVCOLOR(uint64_t data, char* line)
+{
+	uint8_t r = (uint8_t)((data & 0xFF000000) >> 24);
+	uint8_t g = (uint8_t)((data & 0x00FF0000) >> 16);
+	uint8_t b = (uint8_t)((data & 0xFF00FF00) >> 8);
+	uint8_t a = (uint8_t)((data & 0x000000FF) >> 0);
+
+	sprintf(line, "gsDPSetEnvColor(%i, %i, %i, %i),", r, g, b, a);
+}
+
+void ZDisplayList::Opcode_G_RDPHALF_1(uint64_t data, int32_t i, const std::string& prefix,
+                                      char* line)
+{
+	uint64_t data2 = instructions[i + 1];
+	uint32_t h = (data & 0xFFFFFFFF);
+	F3DZEXOpcode opcode2 = (F3DZEXOpcode)(instructions[i + 1] >> 56);
+
+	if (opcode2 == F3DZEXOpcode::G_BRANCH_Z)
+	{
+		uint32_t a = (data2 & 0x00FFF00000000000) >> 44;
+		uint32_t b = (data2 & 0x00000FFF00000000) >> 32;
+		uint32_t z = (data2 & 0x00000000FFFFFFFF) >> 0;
+
+		// sprintf(line, "gsDPWord(%i, 0),", h);
+		sprintf(line, "gsSPBranchLessZraw(%sDlist0x%06X, 0x%02X, 0x%02X),", prefix.c_str(),
+		        h & 0x00FFFFFF, (a / 5) | (b / 2), z);
+
+		ZDisplayList* nList = parent->GetOrCreateDisplayList(h & 0x00FFFFFF);
+		nList->scene = scene;
+		otherDLists.push_back(nList);
+	}
 }
 
-void ZDisplayList::Opcode_G_DL(uint64_t data, std::string prefix, char* line)
+void ZDisplayList::Opcode_G_DL(uint64_t data, const std::string& prefix, char* line)
 {
 	int32_t pp = (data & 0x00FF000000000000) >> 56;
 	int32_t segNum = GETSEGNUM(data);
@@ -704,9 +754,7 @@ void ZDisplayList::Opcode_G_DL(uint64_t data, std::string prefix, char* line)
 	}
 	else
 	{
-		ZDisplayList* nList = new ZDisplayList(
-			GETSEGOFFSET(data), GetDListLength(parent->GetRawData(), GETSEGOFFSET(data), dListType),
-			parent);
+		ZDisplayList* nList = parent->GetOrCreateDisplayList(GETSEGOFFSET(data));
 
 		// if (scene != nullptr)
 		{
@@ -863,20 +911,7 @@ void ZDisplayList::Opcode_G_VTX(uint64_t data, char* line)
 
 		if (nn > 0)
 		{
-			std::vector<ZVtx> vtxList;
-			vtxList.reserve(nn);
-
-			for (int32_t i = 0; i < nn; i++)
-			{
-				ZVtx vtx(parent);
-				vtx.SetRawDataIndex(currentPtr);
-				vtx.ParseRawData();
-				vtxList.push_back(vtx);
-
-				currentPtr += 16;
-			}
-
-			vertices[vtxAddr] = vtxList;
+			vertices[vtxAddr] = VtxEntry::ParseArray(parent->GetRawData(), currentPtr, nn);
 		}
 	}
 }
@@ -899,7 +934,7 @@ void ZDisplayList::Opcode_G_TEXTURE(uint64_t data, char* line)
 	        nnnnnnn == 1 ? "G_ON" : "G_OFF");
 }
 
-void ZDisplayList::Opcode_G_SETTIMG(uint64_t data, std::string prefix, char* line)
+void ZDisplayList::Opcode_G_SETTIMG(uint64_t data, const std::string& prefix, char* line)
 {
 	int32_t __ = (data & 0x00FF000000000000) >> 48;
 	int32_t www = (data & 0x00000FFF00000000) >> 32;
@@ -989,7 +1024,7 @@ void ZDisplayList::Opcode_G_SETTILE(uint64_t data, char* line)
 	        ssss, dd, bbbb, uuuu);
 }
 
-void ZDisplayList::Opcode_G_SETTILESIZE(uint64_t data, std::string prefix, char* line)
+void ZDisplayList::Opcode_G_SETTILESIZE(uint64_t data, const std::string& prefix, char* line)
 {
 	int32_t sss = (data & 0x00FFF00000000000) >> 44;
 	int32_t ttt = (data & 0x00000FFF00000000) >> 32;
@@ -1509,7 +1544,7 @@ void ZDisplayList::Opcode_G_SETOTHERMODE_H(uint64_t data, char* line)
 		sprintf(line, "gsSPSetOtherMode(0xE3, %i, %i, 0x%08X),", sft, nn + 1, dd);
 }
 
-void ZDisplayList::Opcode_G_LOADTLUT(uint64_t data, std::string prefix, char* line)
+void ZDisplayList::Opcode_G_LOADTLUT(uint64_t data, const std::string& prefix, char* line)
 {
 	int32_t t = (data & 0x0000000007000000) >> 24;
 	int32_t ccc = (data & 0x00000000003FF000) >> 14;
@@ -1528,7 +1563,7 @@ void ZDisplayList::Opcode_G_LOADTLUT(uint64_t data, std::string prefix, char* li
 	sprintf(line, "gsDPLoadTLUTCmd(%i, %i),", t, ccc);
 }
 
-void ZDisplayList::Opcode_G_ENDDL(std::string prefix, char* line)
+void ZDisplayList::Opcode_G_ENDDL(const std::string& prefix, char* line)
 {
 	sprintf(line, "gsSPEndDisplayList(),");
 
@@ -1543,122 +1578,77 @@ std::string ZDisplayList::GetSourceOutputHeader(const std::string& prefix)
 	return "";
 }
 
-static int32_t GfxdCallback_FormatSingleEntry(void)
+static void GfxdCheckTriangleTlut(ZDisplayList* self)
 {
-	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
-	gfxd_puts("\t");
-	gfxd_macro_dflt();
-	gfxd_puts(",");
-
-	auto macroId = gfxd_macro_id();
-
-	switch (macroId)
+	if (self->lastTexture != nullptr && self->lastTexture->IsColorIndexed() &&
+	    !self->lastTexture->HasTlut())
 	{
-	case gfxd_SP1Triangle:
-	case gfxd_SP2Triangles:
-		if (self->lastTexture != nullptr && self->lastTexture->IsColorIndexed() &&
-		    !self->lastTexture->HasTlut())
-		{
-			auto tex = self->lastTexture;
-			auto tlut = self->lastTlut;
-
-			if (Globals::Instance->verbosity >= VerbosityLevel::VERBOSITY_DEBUG)
-			{
-				if (tlut != nullptr)
-					printf("CI texture '%s' (0x%X), TLUT: '%s' (0x%X)\n", tex->GetName().c_str(),
-					       tex->GetRawDataIndex(), tlut->GetName().c_str(),
-					       tlut->GetRawDataIndex());
-				else
-					printf("CI texture '%s' (0x%X), TLUT: null\n", tex->GetName().c_str(),
-					       tex->GetRawDataIndex());
-			}
+		auto tex = self->lastTexture;
+		auto tlut = self->lastTlut;
 
-			if (tlut != nullptr && !tex->HasTlut())
-				tex->SetTlut(tlut);
+		if (Globals::Instance->verbosity >= VerbosityLevel::VERBOSITY_DEBUG)
+		{
+			if (tlut != nullptr)
+				printf("CI texture '%s' (0x%X), TLUT: '%s' (0x%X)\n", tex->GetName().c_str(),
+				       tex->GetRawDataIndex(), tlut->GetName().c_str(), tlut->GetRawDataIndex());
+			else
+				printf("CI texture '%s' (0x%X), TLUT: null\n", tex->GetName().c_str(),
+				       tex->GetRawDataIndex());
 		}
-		break;
-	}
 
-	// dont print a new line after the last command
-	if (macroId != gfxd_SPEndDisplayList)
-	{
-		gfxd_puts("\n");
+		if (tlut != nullptr && !tex->HasTlut())
+			tex->SetTlut(tlut);
 	}
-
-	return 0;
 }
 
-static int32_t GfxdCallback_Vtx(uint32_t seg, int32_t count)
+static std::string GfxdGetVtxName(ZDisplayList* self, uint32_t seg, int32_t count)
 {
-	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
 	uint32_t vtxOffset = Seg2Filespace(seg, self->parent->baseAddress);
-	std::string vtxName = "";
 
 	// Probably an external asset we are unable to track
 	if (!Globals::Instance->HasSegment(GETSEGNUM(seg)))
+		return StringHelper::Sprintf("0x%08X", seg);
+
+	self->references.push_back(vtxOffset);
+
+	// Check for vertex intersections from other display lists
+	// TODO: These two could probably be condenced to one...
+	if (self->parent->GetDeclarationRanged(vtxOffset + (count * 16)) != nullptr)
 	{
-		vtxName = StringHelper::Sprintf("0x%08X", seg);
+		// Declaration* decl = self->parent->GetDeclarationRanged(vtxOffset + (count * 16));
+		uint32_t addr = self->parent->GetDeclarationRangedAddress(vtxOffset + (count * 16));
+		int32_t diff = addr - vtxOffset;
+
+		if (diff > 0)
+			count = diff / 16;
+		else
+			count = 0;
 	}
-	else
+
+	if (self->parent->GetDeclarationRanged(vtxOffset) != nullptr)
 	{
-		self->references.push_back(vtxOffset);
+		// Declaration* decl = self->parent->GetDeclarationRanged(vtxOffset);
+		uint32_t addr = self->parent->GetDeclarationRangedAddress(vtxOffset);
+		int32_t diff = addr - vtxOffset;
 
-		// Check for vertex intersections from other display lists
-		// TODO: These two could probably be condenced to one...
-		if (self->parent->GetDeclarationRanged(vtxOffset + (count * 16)) != nullptr)
-		{
-			// Declaration* decl = self->parent->GetDeclarationRanged(vtxOffset + (count * 16));
-			uint32_t addr = self->parent->GetDeclarationRangedAddress(vtxOffset + (count * 16));
-			int32_t diff = addr - vtxOffset;
+		if (diff > 0)
+			count = diff / 16;
+		else
+			count = 0;
+	}
 
-			if (diff > 0)
-				count = diff / 16;
-			else
-				count = 0;
-		}
-
-		if (self->parent->GetDeclarationRanged(vtxOffset) != nullptr)
-		{
-			// Declaration* decl = self->parent->GetDeclarationRanged(vtxOffset);
-			uint32_t addr = self->parent->GetDeclarationRangedAddress(vtxOffset);
-			int32_t diff = addr - vtxOffset;
-
-			if (diff > 0)
-				count = diff / 16;
-			else
-				count = 0;
-		}
-
-		if (count > 0)
-		{
-			std::vector<ZVtx> vtxList;
-			vtxList.reserve(count);
-
-			uint32_t currentPtr = vtxOffset;
-			for (int32_t i = 0; i < count; i++)
-			{
-				ZVtx vtx(self->parent);
-				vtx.SetRawDataIndex(currentPtr);
-				vtx.ParseRawData();
-
-				vtxList.push_back(vtx);
-				currentPtr += 16;
-			}
-			self->vertices[vtxOffset] = vtxList;
-		}
-
-		vtxName = "@r";
+	if (count > 0)
+	{
+		self->vertices[vtxOffset] =
+			VtxEntry::ParseArray(self->parent->GetRawData(), vtxOffset, count);
 	}
 
-	gfxd_puts(vtxName.c_str());
-
-	return 1;
+	return "@r";
 }
 
-static int32_t GfxdCallback_Texture(segptr_t seg, int32_t fmt, int32_t siz, int32_t width,
-                                    int32_t height, int32_t pal)
+static std::string GfxdGetTextureName(ZDisplayList* self, segptr_t seg, int32_t fmt, int32_t siz,
+                                      int32_t width, int32_t height, int32_t pal)
 {
-	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
 	uint32_t texOffset = Seg2Filespace(seg, self->parent->baseAddress);
 	int32_t texSegNum = GETSEGNUM(seg);
 
@@ -1673,28 +1663,21 @@ static int32_t GfxdCallback_Texture(segptr_t seg, int32_t fmt, int32_t siz, int3
 
 	self->TextureGenCheck(self->curPrefix);
 
-	std::string texName = "";
-
 	ZFile* auxParent = self->parent;
 	if (self->parent->segment != texSegNum && Globals::Instance->HasSegment(texSegNum))
 		auxParent = Globals::Instance->segmentRefFiles.at(texSegNum);
 
 	Declaration* decl = auxParent->GetDeclaration(texOffset);
 	if (Globals::Instance->HasSegment(texSegNum) && decl != nullptr)
-		texName = decl->varName;
+		return decl->varName;
 	else if (self->lastTexture != nullptr)
-		texName = self->lastTexture->GetName();
+		return self->lastTexture->GetName();
 	else
-		texName = auxParent->GetDeclarationPtrName(seg);
-
-	gfxd_puts(texName.c_str());
-
-	return 1;
+		return auxParent->GetDeclarationPtrName(seg);
 }
 
-static int32_t GfxdCallback_Palette(uint32_t seg, int32_t idx, int32_t count)
+static std::string GfxdGetPaletteName(ZDisplayList* self, uint32_t seg, int32_t idx, int32_t count)
 {
-	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
 	uint32_t palOffset = Seg2Filespace(seg, self->parent->baseAddress);
 	int32_t palSegNum = GETSEGNUM(seg);
 
@@ -1709,39 +1692,28 @@ static int32_t GfxdCallback_Palette(uint32_t seg, int32_t idx, int32_t count)
 
 	self->TextureGenCheck(self->curPrefix);
 
-	std::string palName = "";
-
 	ZFile* auxParent = self->parent;
 	if (self->parent->segment != palSegNum && Globals::Instance->HasSegment(palSegNum))
 		auxParent = Globals::Instance->segmentRefFiles.at(palSegNum);
 
 	Declaration* decl = auxParent->GetDeclaration(palOffset);
 	if (Globals::Instance->HasSegment(palSegNum) && decl != nullptr)
-		palName = decl->varName;
+		return decl->varName;
 	else if (self->lastTlut != nullptr)
-		palName = self->lastTlut->GetName();
+		return self->lastTlut->GetName();
 	else
-		palName = auxParent->GetDeclarationPtrName(seg);
-
-	gfxd_puts(palName.c_str());
-
-	return 1;
+		return auxParent->GetDeclarationPtrName(seg);
 }
 
-static int32_t GfxdCallback_DisplayList(uint32_t seg)
+static std::string GfxdGetDisplayListName(ZDisplayList* self, uint32_t seg)
 {
-	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
 	uint32_t dListOffset = GETSEGOFFSET(seg);
 	int32_t dListSegNum = GETSEGNUM(seg);
 
 	if ((dListSegNum <= 6) && Globals::Instance->HasSegment(dListSegNum))
 	{
-		ZDisplayList* newDList = new ZDisplayList(
-			dListOffset,
-			self->GetDListLength(self->parent->GetRawData(), dListOffset, self->dListType),
-			self->parent);
+		ZDisplayList* newDList = self->parent->GetOrCreateDisplayList(dListOffset);
 		newDList->scene = self->scene;
-		newDList->parent = self->parent;
 		self->otherDLists.push_back(newDList);
 	}
 
@@ -1749,111 +1721,195 @@ static int32_t GfxdCallback_DisplayList(uint32_t seg)
 	if (self->parent->segment != dListSegNum && Globals::Instance->HasSegment(dListSegNum))
 		auxParent = Globals::Instance->segmentRefFiles.at(dListSegNum);
 
-	std::string dListName = auxParent->GetDeclarationPtrName(seg);
+	return auxParent->GetDeclarationPtrName(seg);
+}
 
-	gfxd_puts(dListName.c_str());
+static std::string GfxdGetMatrixName(ZDisplayList* self, uint32_t seg)
+{
+	if (Globals::Instance->symbolMap.find(seg) != Globals::Instance->symbolMap.end())
+		return StringHelper::Sprintf("&%s", Globals::Instance->symbolMap[seg].c_str());
 
-	return 1;
+	if (!Globals::Instance->HasSegment(GETSEGNUM(seg)))
+		return StringHelper::Sprintf("0x%08X", seg);
+
+	Declaration* decl = self->parent->GetDeclaration(Seg2Filespace(seg, self->parent->baseAddress));
+	if (decl != nullptr)
+		return "&" + decl->varName;
+
+	ZMtx mtx(self->GetName(), Seg2Filespace(seg, self->parent->baseAddress), self->parent);
+
+	mtx.GetSourceOutputCode(self->GetName());
+	self->mtxList.push_back(mtx);
+	return "&" + mtx.GetName();
 }
 
-static int32_t GfxdCallback_Matrix(uint32_t seg)
+static int32_t GfxdCallback_FormatSingleEntry(void)
 {
-	std::string mtxName = "";
 	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
+	gfxd_puts("\t");
+	gfxd_macro_dflt();
+	gfxd_puts(",");
 
-	if (Globals::Instance->symbolMap.find(seg) != Globals::Instance->symbolMap.end())
-		mtxName = StringHelper::Sprintf("&%s", Globals::Instance->symbolMap[seg].c_str());
-	else if (Globals::Instance->HasSegment(GETSEGNUM(seg)))
+	auto macroId = gfxd_macro_id();
+
+	switch (macroId)
 	{
-		Declaration* decl =
-			self->parent->GetDeclaration(Seg2Filespace(seg, self->parent->baseAddress));
-		if (decl == nullptr)
-		{
-			ZMtx mtx(self->GetName(), Seg2Filespace(seg, self->parent->baseAddress), self->parent);
+	case gfxd_SP1Triangle:
+	case gfxd_SP2Triangles:
+		GfxdCheckTriangleTlut(self);
+		break;
+	}
 
-			mtx.GetSourceOutputCode(self->GetName());
-			self->mtxList.push_back(mtx);
-			mtxName = "&" + mtx.GetName();
-		}
-		else
-		{
-			mtxName = "&" + decl->varName;
-		}
+	// dont print a new line after the last command
+	if (macroId != gfxd_SPEndDisplayList)
+	{
+		gfxd_puts("\n");
 	}
-	else
-		mtxName = StringHelper::Sprintf("0x%08X", seg);
 
-	gfxd_puts(mtxName.c_str());
+	return 0;
+}
+
+static int32_t GfxdCallback_Vtx(uint32_t seg, int32_t count)
+{
+	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
+	gfxd_puts(GfxdGetVtxName(self, seg, count).c_str());
 
 	return 1;
 }
 
-std::string ZDisplayList::GetSourceOutputCode(const std::string& prefix)
+static int32_t GfxdCallback_Texture(segptr_t seg, int32_t fmt, int32_t siz, int32_t width,
+                                    int32_t height, int32_t pal)
 {
-	std::string sourceOutput = "";
+	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
+	gfxd_puts(GfxdGetTextureName(self, seg, fmt, siz, width, height, pal).c_str());
 
-	if (Globals::Instance->useLegacyZDList)
-		sourceOutput += ProcessLegacy(prefix);
-	else
-		sourceOutput += ProcessGfxDis(prefix);
+	return 1;
+}
 
-	// Iterate through our vertex lists, connect intersecting lists.
-	if (vertices.size() > 0)
+static int32_t GfxdCallback_Palette(uint32_t seg, int32_t idx, int32_t count)
+{
+	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
+	gfxd_puts(GfxdGetPaletteName(self, seg, idx, count).c_str());
+
+	return 1;
+}
+
+static int32_t GfxdCallback_DisplayList(uint32_t seg)
+{
+	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
+	gfxd_puts(GfxdGetDisplayListName(self, seg).c_str());
+
+	return 1;
+}
+
+static int32_t GfxdCallback_Matrix(uint32_t seg)
+{
+	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
+	gfxd_puts(GfxdGetMatrixName(self, seg).c_str());
+
+	return 1;
+}
+
+// The recording callbacks below don't touch anything shared, so they can run on worker threads.
+// Every argument they would resolve is replaced by GFXD_EVENT_MARK in the text and saved in
+// gfxdEvents, so ProcessGfxDis can resolve them later in the same order as a direct run would.
+#define GFXD_EVENT_MARK '\x01'
+
+static void GfxdRecordEvent(GfxdEventType type, uint32_t seg, int32_t arg0 = 0, int32_t arg1 = 0,
+                            int32_t arg2 = 0, int32_t arg3 = 0, int32_t arg4 = 0)
+{
+	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
+	self->gfxdEvents.push_back({type, seg, {arg0, arg1, arg2, arg3, arg4}});
+
+	if (type != GfxdEventType::Triangle)
 	{
-		std::vector<std::pair<uint32_t, std::vector<ZVtx>>> verticesSorted(vertices.begin(),
-		                                                                   vertices.end());
+		char mark[] = {GFXD_EVENT_MARK, '\0'};
+		gfxd_puts(mark);
+	}
+}
 
-		for (size_t i = 0; i < verticesSorted.size() - 1; i++)
-		{
-			size_t vtxSize = vertices[verticesSorted[i].first].size() * 16;
+static int32_t GfxdRecord_FormatSingleEntry(void)
+{
+	gfxd_puts("\t");
+	gfxd_macro_dflt();
+	gfxd_puts(",");
 
-			if ((verticesSorted[i].first + vtxSize) > verticesSorted[i + 1].first)
-			{
-				int32_t intersectAmt =
-					(verticesSorted[i].first + vtxSize) - verticesSorted[i + 1].first;
-				int32_t intersectIndex = intersectAmt / 16;
+	auto macroId = gfxd_macro_id();
 
-				for (size_t j = intersectIndex; j < verticesSorted[i + 1].second.size(); j++)
-					vertices[verticesSorted[i].first].push_back(verticesSorted[i + 1].second[j]);
+	if (macroId == gfxd_SP1Triangle || macroId == gfxd_SP2Triangles)
+		GfxdRecordEvent(GfxdEventType::Triangle, 0);
 
-				vertices.erase(verticesSorted[i + 1].first);
-				verticesSorted.erase(verticesSorted.begin() + i + 1);
+	// dont print a new line after the last command
+	if (macroId != gfxd_SPEndDisplayList)
+		gfxd_puts("\n");
 
-				i--;
-			}
-		}
+	return 0;
+}
 
-		if (scene == nullptr)  // TODO: Bit of a hack but it works for now...
-			parent->defines += defines;
+static int32_t GfxdRecord_Vtx(uint32_t seg, int32_t count)
+{
+	GfxdRecordEvent(GfxdEventType::Vtx, seg, count);
+	return 1;
+}
 
-		// Generate Vertex Declarations
-		for (auto& item : vertices)
-		{
-			std::string declaration = "";
+static int32_t GfxdRecord_Texture(segptr_t seg, int32_t fmt, int32_t siz, int32_t width,
+                                  int32_t height, int32_t pal)
+{
+	GfxdRecordEvent(GfxdEventType::Texture, seg, fmt, siz, width, height, pal);
+	return 1;
+}
 
-			uint32_t curAddr = item.first;
+static int32_t GfxdRecord_Palette(uint32_t seg, int32_t idx, int32_t count)
+{
+	GfxdRecordEvent(GfxdEventType::Palette, seg, idx, count);
+	return 1;
+}
 
-			for (auto vtx : item.second)
-			{
-				if (curAddr != item.first)
-					declaration += "\n";
+static int32_t GfxdRecord_DisplayList(uint32_t seg)
+{
+	GfxdRecordEvent(GfxdEventType::DisplayList, seg);
+	return 1;
+}
 
-				declaration += vtx.GetBodySourceCode();
+static int32_t GfxdRecord_Matrix(uint32_t seg)
+{
+	GfxdRecordEvent(GfxdEventType::Matrix, seg);
+	return 1;
+}
 
-				curAddr += 16;
-			}
+static int GfxdRecord_Output(const char* buf, int count)
+{
+	ZDisplayList* self = static_cast<ZDisplayList*>(gfxd_udata_get());
+	self->gfxdRecordedOutput.append(buf, count);
 
-			vtxDeclarations[item.first] = declaration;
+	return count;
+}
 
-			if (parent != nullptr)
-			{
-				parent->AddDeclarationArray(item.first, DeclarationAlignment::None,
-				                            item.second.size() * 16, "static Vtx",
-				                            StringHelper::Sprintf("%sVtx_%06X", prefix.c_str(),
-				                                                  item.first, item.second.size()),
-				                            item.second.size(), declaration);
-			}
-		}
+std::string ZDisplayList::GetSourceOutputCode(const std::string& prefix)
+{
+	// Display lists from ZFile's registry can be reached several times, they are only
+	// disassembled and declared the first time.
+	if (wasSourceOutputGenerated)
+		return "";
+	wasSourceOutputGenerated = true;
+
+	std::string sourceOutput = "";
+	auto start = std::chrono::steady_clock::now();
+
+	if (Globals::Instance->useLegacyZDList)
+		sourceOutput += ProcessLegacy(prefix);
+	else
+		sourceOutput += ProcessGfxDis(prefix);
+
+	auto disassemblyEnd = std::chrono::steady_clock::now();
+
+	// Iterate through our vertex lists, connect intersecting lists.
+	if (vertices.size() > 0)
+	{
+		MergeVertexLists();
+
+		if (scene == nullptr)  // TODO: Bit of a hack but it works for now...
+			parent->defines += defines;
 	}
 
 	if (scene != nullptr)
@@ -1863,103 +1919,151 @@ std::string ZDisplayList::GetSourceOutputCode(const std::string& prefix)
 	{
 		Declaration* decl = DeclareVar("", sourceOutput);
 		decl->references = references;
-		// return "";
-		// return sourceOutput;
 	}
 
-	// Iterate through our vertex lists, connect intersecting lists.
-	if (vertices.size() > 0)
+	// Generate Vertex Declarations
+	for (const auto& item : vertices)
 	{
-		std::vector<std::pair<uint32_t, std::vector<ZVtx>>> verticesSorted(vertices.begin(),
-		                                                                   vertices.end());
+		std::string declaration = "";
 
-		for (size_t i = 0; i < verticesSorted.size() - 1; i++)
+		uint32_t curAddr = item.first;
+
+		for (const auto& vtx : item.second)
 		{
-			// int32_t vtxSize = verticesSorted[i].second.size() * 16;
-			size_t vtxSize = vertices[verticesSorted[i].first].size() * 16;
+			if (curAddr != item.first)
+				declaration += "\n";
 
-			if ((verticesSorted[i].first + vtxSize) > verticesSorted[i + 1].first)
-			{
-				int32_t intersectAmt =
-					(verticesSorted[i].first + vtxSize) - verticesSorted[i + 1].first;
-				int32_t intersectIndex = intersectAmt / 16;
+			declaration += "    " + vtx.GetBodySourceCode() + ",";
 
-				for (size_t j = intersectIndex; j < verticesSorted[i + 1].second.size(); j++)
-					vertices[verticesSorted[i].first].push_back(verticesSorted[i + 1].second[j]);
+			curAddr += 16;
+		}
 
-				vertices.erase(verticesSorted[i + 1].first);
-				verticesSorted.erase(verticesSorted.begin() + i + 1);
+		// Ensure there's always a trailing line feed to prevent dumb warnings.
+		// Please don't remove this line, unless you somehow made a way to prevent
+		// that warning when building the OoT repo.
+		declaration += "\n";
 
-				i--;
-			}
-		}
+		vtxDeclarations[item.first] = declaration;
 
-		if (scene == nullptr)  // TODO: Bit of a hack but it works for now...
-			parent->defines += defines;
+		if (parent != nullptr)
+		{
+			std::string vtxName = StringHelper::Sprintf("%sVtx_%06X", prefix.c_str(), item.first);
 
-		// Generate Vertex Declarations
-		std::vector<int32_t> vtxKeys;
+			auto filepath = Globals::Instance->outputPath / vtxName;
+			std::string incStr = StringHelper::Sprintf("%s.%s.inc", filepath.c_str(), "vtx");
 
-		for (auto& item : vertices)
-			vtxKeys.push_back(item.first);
+			parent->AddDeclarationArray(item.first, DeclarationAlignment::None,
+			                            item.second.size() * 16, "static Vtx", vtxName,
+			                            item.second.size(), declaration);
 
-		// for (pair<int32_t, vector<Vertex>> item : vertices)
-		for (size_t i = 0; i < vtxKeys.size(); i++)
-		{
-			auto& item = vertices[vtxKeys[i]];
+			Declaration* vtxDecl =
+				parent->AddDeclarationIncludeArray(item.first, incStr, item.second.size() * 16,
+			                                       "static Vtx", vtxName, item.second.size());
+			vtxDecl->isExternal = true;
+		}
+	}
 
-			std::string declaration = "";
+	if (Globals::Instance->dlStatsPath != "" && parent != nullptr)
+	{
+		auto end = std::chrono::steady_clock::now();
+		stats.disassemblyTime +=
+			std::chrono::duration<double, std::milli>(disassemblyEnd - start).count();
+		stats.vertexTime += std::chrono::duration<double, std::milli>(end - disassemblyEnd).count();
 
-			int32_t curAddr = vtxKeys[i];
+		CollectInstructionStats();
+		parent->AddDListStats(stats);
+	}
 
-			for (auto& vtx : item)
-			{
-				if (curAddr != vtxKeys[i])
-					declaration += "\n";
+	if (parent != nullptr)
+		return "";
 
-				declaration +=
-					StringHelper::Sprintf("    VTX(%i, %i, %i, %i, %i, %i, %i, %i, %i),", vtx.x,
-				                          vtx.y, vtx.z, vtx.s, vtx.t, vtx.r, vtx.g, vtx.b, vtx.a);
+	return sourceOutput;
+}
 
-				curAddr += 16;
-			}
+void ZDisplayList::CollectInstructionStats()
+{
+	const char* fmtTbl[] = {"G_IM_FMT_RGBA", "G_IM_FMT_YUV", "G_IM_FMT_CI", "G_IM_FMT_IA",
+	                        "G_IM_FMT_I"};
+	const char* sizTbl[] = {"G_IM_SIZ_4b", "G_IM_SIZ_8b", "G_IM_SIZ_16b", "G_IM_SIZ_32b"};
+	uint8_t vtxOpcode = (uint8_t)F3DZEXOpcode::G_VTX;
 
-			// Ensure there's always a trailing line feed to prevent dumb warnings.
-			// Please don't remove this line, unless you somehow made a way to prevent
-			// that warning when building the OoT repo.
-			declaration += "\n";
+	if (dListType == DListType::F3DEX)
+		vtxOpcode = (uint8_t)F3DEXOpcode::G_VTX;
 
-			vtxDeclarations[vtxKeys[i]] = declaration;
+	stats.name = name;
+	stats.offset = rawDataIndex;
+	stats.instructionCount = instructions.size();
 
-			if (parent != nullptr)
-			{
-				std::string vtxName =
-					StringHelper::Sprintf("%sVtx_%06X", prefix.c_str(), vtxKeys[i]);
+	for (uint64_t data : instructions)
+	{
+		uint8_t opcode = data >> 56;
+		stats.opcodeCounts[opcode]++;
 
-				auto filepath = Globals::Instance->outputPath / vtxName;
-				std::string incStr = StringHelper::Sprintf("%s.%s.inc", filepath.c_str(), "vtx");
+		if (opcode == vtxOpcode)
+		{
+			uint32_t count = (data >> 44) & 0xFF;
 
-				parent->AddDeclarationArray(vtxKeys[i], DeclarationAlignment::None,
-				                            item.size() * 16, "static Vtx", vtxName, item.size(),
-				                            declaration);
+			if (dListType == DListType::F3DEX)
+				count = (data >> 42) & 0x3F;
 
-				Declaration* vtxDecl = parent->AddDeclarationIncludeArray(
-					vtxKeys[i], incStr, item.size() * 16, "static Vtx", vtxName, item.size());
-				vtxDecl->isExternal = true;
-			}
+			stats.vertexLoads++;
+			stats.vertexBytes += count * 16;
+		}
+		else if (opcode == (uint8_t)F3DZEXOpcode::G_SETTIMG)
+		{
+			uint32_t fmt = (data >> 53) & 0x07;
+			uint32_t siz = (data >> 51) & 0x03;
+			std::string fmtStr = fmt < 5 ? fmtTbl[fmt] : StringHelper::Sprintf("%u", fmt);
+
+			stats.textureLoads[fmtStr + " " + sizTbl[siz]]++;
 		}
 	}
 
-	if (parent != nullptr)
-		return "";
+	for (ZDisplayList* otherDList : otherDLists)
+		stats.children.push_back(otherDList->GetRawDataIndex());
+}
 
-	return sourceOutput;
+// Connects intersecting vertex lists. The map is sorted by address, so a single pass that keeps
+// extending the current list until it stops overlapping the next one is enough.
+void ZDisplayList::MergeVertexLists()
+{
+	auto current = vertices.begin();
+	auto next = std::next(current);
+
+	while (next != vertices.end())
+	{
+		size_t vtxSize = current->second.size() * 16;
+
+		if ((current->first + vtxSize) > next->first)
+		{
+			int32_t intersectAmt = (current->first + vtxSize) - next->first;
+			size_t intersectIndex = intersectAmt / 16;
+
+			if (intersectIndex < next->second.size())
+			{
+				current->second.insert(current->second.end(),
+				                       next->second.begin() + intersectIndex, next->second.end());
+			}
+
+			next = vertices.erase(next);
+		}
+		else
+		{
+			current = next;
+			next++;
+		}
+	}
 }
 
 std::string ZDisplayList::ProcessLegacy(const std::string& prefix)
 {
 	char line[4096];
 	std::string sourceOutput = "";
+	std::vector<int32_t> macroMatches;
+
+	// Macros are only emitted for scene display lists
+	if (scene != nullptr)
+		macroMatches = FindMacroPatterns();
 
 	for (size_t i = 0; i < instructions.size(); i++)
 	{
@@ -1967,9 +2071,19 @@ std::string ZDisplayList::ProcessLegacy(const std::string& prefix)
 		uint64_t data = instructions[i];
 		sourceOutput += "    ";
 
-		auto start = std::chrono::steady_clock::now();
+		bool isTimed = Globals::Instance->verbosity >= VerbosityLevel::VERBOSITY_DEBUG;
+		std::chrono::steady_clock::time_point start;
+
+		if (isTimed)
+			start = std::chrono::steady_clock::now();
+
+		int32_t optimizationResult = -1;
 
-		int32_t optimizationResult = OptimizationChecks(i, sourceOutput, prefix);
+		if (!macroMatches.empty() && macroMatches[i] != -1)
+		{
+			OptimizationCheck check = macroPatterns[macroMatches[i]].check;
+			optimizationResult = (this->*check)(i, sourceOutput, prefix);
+		}
 
 		if (optimizationResult != -1)
 		{
@@ -1977,18 +2091,17 @@ std::string ZDisplayList::ProcessLegacy(const std::string& prefix)
 			line[0] = '\0';
 		}
 		else
-		{
-			if (dListType == DListType::F3DZEX)
-				ParseF3DZEX((F3DZEXOpcode)opcode, data, i, prefix, line);
-			else
-				ParseF3DEX((F3DEXOpcode)opcode, data, prefix, line);
-		}
+			ParseInstruction(data, i, prefix, line);
 
-		auto end = std::chrono::steady_clock::now();
-		auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+		if (isTimed)
+		{
+			auto end = std::chrono::steady_clock::now();
+			auto diff =
+				std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 
-		if (Globals::Instance->verbosity >= VerbosityLevel::VERBOSITY_DEBUG && diff > 5)
-			printf("F3DOP: 0x%02X, TIME: %lims\n", opcode, diff);
+			if (diff > 5)
+				printf("F3DOP: 0x%02X, TIME: %lims\n", opcode, diff);
+		}
 
 		sourceOutput += line;
 
@@ -1999,15 +2112,105 @@ std::string ZDisplayList::ProcessLegacy(const std::string& prefix)
 	return sourceOutput;
 }
 
+void ZDisplayList::SetupGfxd()
+{
+	int32_t dListSize = instructions.size() * sizeof(instructions[0]);
+
+	// gfxd reads the big-endian file data directly, no need to go through instructions
+	gfxd_input_buffer(parent->GetRawData().data() + rawDataIndex, dListSize);
+	gfxd_endian(gfxd_endian_big, sizeof(uint64_t));  // tell gfxdis what format the data is
+
+	gfxd_enable(gfxd_emit_dec_color);  // use decimal for colors
+
+	// set microcode. see gfxd.h for more options.
+	if (dListType == DListType::F3DZEX)
+		gfxd_target(gfxd_f3dex2);
+	else
+		gfxd_target(gfxd_f3dex);
+
+	gfxd_udata_set(this);
+}
+
+void ZDisplayList::PredecodeGfxDis()
+{
+	SetupGfxd();
+
+	gfxd_macro_fn(GfxdRecord_FormatSingleEntry);
+	gfxd_vtx_callback(GfxdRecord_Vtx);
+	gfxd_timg_callback(GfxdRecord_Texture);
+	gfxd_tlut_callback(GfxdRecord_Palette);
+	gfxd_dl_callback(GfxdRecord_DisplayList);
+	gfxd_mtx_callback(GfxdRecord_Matrix);
+	gfxd_output_callback(GfxdRecord_Output);
+
+	gfxd_execute();
+	isGfxdPredecoded = true;
+}
+
+// libgfxd only keeps its state per thread when it's built with CONFIG_MT. Without it, the config
+// set by one thread is the one every thread sees, which is what this checks.
+static bool IsGfxdThreadSafe()
+{
+	static const bool threadSafe = []() {
+		void* prevUdata = gfxd_udata_get();
+		int32_t probe = 0;
+		void* seenUdata = nullptr;
+
+		gfxd_udata_set(&probe);
+		std::thread([&]() { seenUdata = gfxd_udata_get(); }).join();
+		gfxd_udata_set(prevUdata);
+
+		if (seenUdata == &probe)
+			fprintf(stderr, "Warning: libgfxd wasn't built with CONFIG_MT, display lists will be "
+			                "disassembled in a single thread.\n");
+
+		return seenUdata != &probe;
+	}();
+
+	return threadSafe;
+}
+
+// Running libgfxd is most of the work of big objects and room meshes with lots of display lists.
+// The ones that haven't been disassembled yet are decoded in parallel first, so GetSourceOutputCode
+// only has to resolve their references and declarations, in the same order as usual.
+void ZDisplayList::PredecodeDisplayLists(const std::vector<ZDisplayList*>& dLists)
+{
+	WorkerPool* workerPool = Globals::Instance->workerPool;
+
+	if (Globals::Instance->useLegacyZDList || workerPool == nullptr)
+		return;
+
+	std::vector<ZDisplayList*> pendingDLists;
+	std::unordered_set<ZDisplayList*> seenDLists;
+
+	for (ZDisplayList* dList : dLists)
+	{
+		if (!dList->isGfxdPredecoded && !dList->wasSourceOutputGenerated &&
+		    seenDLists.insert(dList).second)
+			pendingDLists.push_back(dList);
+	}
+
+	if (pendingDLists.size() < 2 || !IsGfxdThreadSafe())
+		return;
+
+	workerPool->Run(pendingDLists.size(),
+	                [&](size_t i) { pendingDLists[i]->PredecodeGfxDis(); });
+}
+
 std::string ZDisplayList::ProcessGfxDis(const std::string& prefix)
 {
 	std::string sourceOutput = "";
 
 	OutputFormatter outputformatter;
-	int32_t dListSize = instructions.size() * sizeof(instructions[0]);
+	this->curPrefix = prefix;
+
+	if (isGfxdPredecoded)
+	{
+		ReplayGfxdEvents(outputformatter);
+		return outputformatter.GetOutput();
+	}
 
-	gfxd_input_buffer(instructions.data(), dListSize);
-	gfxd_endian(gfxd_endian_little, sizeof(uint64_t));  // tell gfxdis what format the data is
+	SetupGfxd();
 
 	gfxd_macro_fn(GfxdCallback_FormatSingleEntry);  // format for each command entry
 	gfxd_vtx_callback(GfxdCallback_Vtx);            // handle vertices
@@ -2018,24 +2221,66 @@ std::string ZDisplayList::ProcessGfxDis(const std::string& prefix)
 	gfxd_output_callback(
 		outputformatter.StaticWriter());  // convert tabs to 4 spaces and enforce 120 line limit
 
-	gfxd_enable(gfxd_emit_dec_color);  // use decimal for colors
-
-	// set microcode. see gfxd.h for more options.
-	if (dListType == DListType::F3DZEX)
-		gfxd_target(gfxd_f3dex2);
-	else
-		gfxd_target(gfxd_f3dex);
-
-	this->curPrefix = prefix;
-	gfxd_udata_set(this);
 	gfxd_execute();                               // generate display list
 	sourceOutput += outputformatter.GetOutput();  // write formatted display list
 
 	return sourceOutput;
 }
 
+void ZDisplayList::ReplayGfxdEvents(OutputFormatter& outputformatter)
+{
+	size_t textPos = 0;
+
+	auto writeNextText = [&]() {
+		size_t markPos = gfxdRecordedOutput.find(GFXD_EVENT_MARK, textPos);
+		if (markPos == std::string::npos)
+			markPos = gfxdRecordedOutput.size();
+
+		outputformatter.Write(gfxdRecordedOutput.data() + textPos, markPos - textPos);
+		textPos = markPos + 1;
+	};
+
+	writeNextText();
+
+	for (const GfxdEvent& event : gfxdEvents)
+	{
+		const int32_t* args = event.args;
+
+		switch (event.type)
+		{
+		case GfxdEventType::Triangle:
+			GfxdCheckTriangleTlut(this);
+			continue;
+		case GfxdEventType::Vtx:
+			outputformatter.Write(GfxdGetVtxName(this, event.seg, args[0]));
+			break;
+		case GfxdEventType::Texture:
+			outputformatter.Write(
+				GfxdGetTextureName(this, event.seg, args[0], args[1], args[2], args[3], args[4]));
+			break;
+		case GfxdEventType::Palette:
+			outputformatter.Write(GfxdGetPaletteName(this, event.seg, args[0], args[1]));
+			break;
+		case GfxdEventType::DisplayList:
+			outputformatter.Write(GfxdGetDisplayListName(this, event.seg));
+			break;
+		case GfxdEventType::Matrix:
+			outputformatter.Write(GfxdGetMatrixName(this, event.seg));
+			break;
+		}
+
+		writeNextText();
+	}
+
+	isGfxdPredecoded = false;
+	gfxdRecordedOutput.clear();
+	gfxdEvents.clear();
+}
+
 void ZDisplayList::TextureGenCheck(std::string prefix)
 {
+	auto start = std::chrono::steady_clock::now();
+
 	if (TextureGenCheck(scene, parent, prefix, lastTexWidth, lastTexHeight, lastTexAddr, lastTexSeg,
 	                    lastTexFmt, lastTexSiz, lastTexLoaded, lastTexIsPalette, this))
 	{
@@ -2043,6 +2288,12 @@ void ZDisplayList::TextureGenCheck(std::string prefix)
 		lastTexLoaded = false;
 		lastTexIsPalette = false;
 	}
+
+	if (Globals::Instance->dlStatsPath != "")
+	{
+		auto end = std::chrono::steady_clock::now();
+		stats.textureTime += std::chrono::duration<double, std::milli>(end - start).count();
+	}
 }
 
 bool ZDisplayList::TextureGenCheck(ZRoom* scene, ZFile* parent, std::string prefix,
@@ -2064,21 +2315,30 @@ bool ZDisplayList::TextureGenCheck(ZRoom* scene, ZFile* parent, std::string pref
 	if ((texSeg != 0 || texAddr != 0) && texWidth > 0 && texHeight > 0 && texLoaded &&
 	    Globals::Instance->HasSegment(segmentNumber))
 	{
+		TextureType texType = TexFormatToTexType(texFmt, texSiz);
+
 		if (segmentNumber != SEGMENT_SCENE)
 		{
 			if (texAddr < parent->GetRawData().size())
 			{
-				ZTexture* tex = parent->GetTextureResource(texAddr);
-				if (tex != nullptr)
-					tex->isPalette = texIsPalette;
-				else
+				ZTexture* tex = nullptr;
+
+				if (!parent->GetDListTexture(segmentNumber, texAddr, texType, tex))
 				{
-					tex = new ZTexture(parent);
-					tex->FromBinary(texAddr, texWidth, texHeight,
-					                TexFormatToTexType(texFmt, texSiz), texIsPalette);
-					parent->AddTextureResource(texAddr, tex);
+					tex = parent->GetTextureResource(texAddr);
+
+					if (tex == nullptr)
+					{
+						tex = new ZTexture(parent);
+						tex->FromBinary(texAddr, texWidth, texHeight, texType, texIsPalette);
+						parent->AddTextureResource(texAddr, tex);
+					}
+
+					parent->AddDListTexture(segmentNumber, texAddr, texType, tex);
 				}
 
+				tex->isPalette = texIsPalette;
+
 				if (!texIsPalette)
 					self->lastTexture = tex;
 				else
@@ -2089,33 +2349,20 @@ bool ZDisplayList::TextureGenCheck(ZRoom* scene, ZFile* parent, std::string pref
 		}
 		else if (scene != nullptr)
 		{
-			if (scene->parent->GetDeclaration(texAddr) == nullptr)
-			{
-				ZTexture* tex = scene->parent->GetTextureResource(texAddr);
-				if (tex != nullptr)
-					tex->isPalette = texIsPalette;
-				else
-				{
-					tex = new ZTexture(scene->parent);
-					tex->FromBinary(texAddr, texWidth, texHeight,
-					                TexFormatToTexType(texFmt, texSiz), texIsPalette);
+			if (Globals::Instance->roomCachePath != "")
+				parent->AddSceneTextureRef({texAddr, texWidth, texHeight, texType, texIsPalette});
 
-					scene->parent->AddTextureResource(texAddr, tex);
-				}
+			ZTexture* tex =
+				DeclareSceneTexture(scene, texAddr, texWidth, texHeight, texType, texIsPalette);
 
+			if (tex != nullptr)
+			{
 				if (!texIsPalette)
 					self->lastTexture = tex;
 				else
 					self->lastTlut = tex;
-
-				auto filepath = Globals::Instance->outputPath /
-								Path::GetFileNameWithoutExtension(tex->GetName());
-				auto filename = StringHelper::Sprintf("%s.%s.inc.c", filepath.c_str(),
-				                                      tex->GetExternalExtension().c_str());
-				scene->parent->AddDeclarationIncludeArray(texAddr, filename, tex->GetRawDataSize(),
-				                                          tex->GetSourceTypeName(), tex->GetName(),
-				                                          0);
 			}
+
 			return true;
 		}
 	}
@@ -2123,6 +2370,43 @@ bool ZDisplayList::TextureGenCheck(ZRoom* scene, ZFile* parent, std::string pref
 	return false;
 }
 
+// Shared by the scene and all its rooms, only the first display list to find a texture declares it.
+// Returns the texture only when this call declared it.
+ZTexture* ZDisplayList::DeclareSceneTexture(ZRoom* scene, uint32_t texAddr, int32_t texWidth,
+                                            int32_t texHeight, TextureType texType,
+                                            bool texIsPalette)
+{
+	ZFile* sceneFile = scene->parent;
+	ZTexture* tex = nullptr;
+
+	if (sceneFile->GetDListTexture(SEGMENT_SCENE, texAddr, texType, tex))
+		return nullptr;
+
+	if (sceneFile->GetDeclaration(texAddr) == nullptr)
+	{
+		tex = sceneFile->GetTextureResource(texAddr);
+		if (tex != nullptr)
+			tex->isPalette = texIsPalette;
+		else
+		{
+			tex = new ZTexture(sceneFile);
+			tex->FromBinary(texAddr, texWidth, texHeight, texType, texIsPalette);
+
+			sceneFile->AddTextureResource(texAddr, tex);
+		}
+
+		auto filepath =
+			Globals::Instance->outputPath / Path::GetFileNameWithoutExtension(tex->GetName());
+		auto filename = StringHelper::Sprintf("%s.%s.inc.c", filepath.c_str(),
+		                                      tex->GetExternalExtension().c_str());
+		sceneFile->AddDeclarationIncludeArray(texAddr, filename, tex->GetRawDataSize(),
+		                                      tex->GetSourceTypeName(), tex->GetName(), 0);
+	}
+
+	sceneFile->AddDListTexture(SEGMENT_SCENE, texAddr, texType, tex);
+	return tex;
+}
+
 TextureType ZDisplayList::TexFormatToTexType(F3DZEXTexFormats fmt, F3DZEXTexSizes siz)
 {
 	if (fmt == F3DZEXTexFormats::G_IM_FMT_RGBA)
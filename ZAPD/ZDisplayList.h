@@ -7,6 +7,7 @@
 #include "ZVtx.h"
 #include "tinyxml2.h"
 
+#include <array>
 #include <map>
 #include <string>
 #include <vector>
@@ -283,27 +284,79 @@ enum class OoTSegments
 #define FORCE_BL 0x4000
 #define TEX_EDGE 0x0000
 
+enum class GfxdEventType
+{
+	Triangle,
+	Vtx,
+	Texture,
+	Palette,
+	DisplayList,
+	Matrix,
+};
+
+// A libgfxd callback recorded by ZDisplayList::PredecodeGfxDis
+struct GfxdEvent
+{
+	GfxdEventType type;
+	uint32_t seg;
+	int32_t args[5];
+};
+
+class OutputFormatter;
+
 class ZDisplayList : public ZResource
 {
 protected:
 	static TextureType TexFormatToTexType(F3DZEXTexFormats fmt, F3DZEXTexSizes siz);
 
-	void ParseF3DZEX(F3DZEXOpcode opcode, uint64_t data, int32_t i, std::string prefix, char* line);
-	void ParseF3DEX(F3DEXOpcode opcode, uint64_t data, std::string prefix, char* line);
+	void ParseF3DZEX(F3DZEXOpcode opcode, uint64_t data, int32_t i, const std::string& prefix,
+	                 char* line);
+	void ParseF3DEX(F3DEXOpcode opcode, uint64_t data, const std::string& prefix, char* line);
+	void ParseInstruction(uint64_t data, int32_t i, const std::string& prefix, char* line);
 
 	// Various Instruction Optimizations
-	bool SequenceCheck(std::vector<F3DZEXOpcode> sequence, int32_t startIndex);
-	int32_t OptimizationChecks(int32_t startIndex, std::string& output, std::string prefix);
+	typedef int32_t (ZDisplayList::*OptimizationCheck)(int32_t startIndex, std::string& output,
+	                                                   const std::string& prefix);
+
+	struct MacroPattern
+	{
+		std::vector<F3DZEXOpcode> sequence;
+		OptimizationCheck check;
+	};
+
+	// Aho-Corasick automaton over the opcode bytes of every pattern in macroPatterns, so all of
+	// them are found with a single pass over the instructions.
+	struct MacroAutomaton
+	{
+		std::vector<std::array<int32_t, 256>> transitions;
+		std::vector<std::vector<int32_t>> matches;  // Patterns ending on each state
+
+		MacroAutomaton(const std::vector<MacroPattern>& patterns);
+	};
+
+	static const std::vector<MacroPattern> macroPatterns;
+
+	std::vector<int32_t> FindMacroPatterns() const;
 	int32_t OptimizationCheck_LoadTextureBlock(int32_t startIndex, std::string& output,
-	                                           std::string prefix);
+	                                           const std::string& prefix);
 	// int32_t OptimizationCheck_LoadMultiBlock(int32_t startIndex, std::string& output, std::string
 	// prefix);
 
+	// F3DZEX Specific Opcode Values
+	void Opcode_G_QUAD(uint64_t data, char* line);
+	void Opcode_G_GEOMETRYMODE(uint64_t data, char* line);
+	void Opcode_G_RDPSETOTHERMODE(uint64_t data, char* line);
+	void Opcode_G_POPMTX(uint64_t data, char* line);
+	void Opcode_G_SETENVCOLOR(uint64_t data, char* line);
+	void Opcode_G_RDPHALF_1(uint64_t data, int32_t i, const std::string& prefix, char* line);
+
 	// F3DEX Specific Opcode Values
 	void Opcode_F3DEX_G_SETOTHERMODE_L(uint64_t data, char* line);
+	void Opcode_F3DEX_G_GEOMETRYMODE(uint64_t data, bool isSet, char* line);
 
 	// Shared Opcodes between F3DZEX and F3DEX
-	void Opcode_G_DL(uint64_t data, std::string prefix, char* line);
+	void Opcode_G_NOOP(uint64_t data, char* line);
+	void Opcode_G_DL(uint64_t data, const std::string& prefix, char* line);
 	void Opcode_G_MODIFYVTX(uint64_t data, char* line);
 	void Opcode_G_CULLDL(uint64_t data, char* line);
 	void Opcode_G_TRI1(uint64_t data, char* line);
@@ -311,16 +364,16 @@ protected:
 	void Opcode_G_MTX(uint64_t data, char* line);
 	void Opcode_G_VTX(uint64_t data, char* line);
 	void Opcode_G_TEXTURE(uint64_t data, char* line);
-	void Opcode_G_SETTIMG(uint64_t data, std::string prefix, char* line);
+	void Opcode_G_SETTIMG(uint64_t data, const std::string& prefix, char* line);
 	void Opcode_G_SETTILE(uint64_t data, char* line);
-	void Opcode_G_SETTILESIZE(uint64_t data, std::string prefix, char* line);
+	void Opcode_G_SETTILESIZE(uint64_t data, const std::string& prefix, char* line);
 	void Opcode_G_LOADBLOCK(uint64_t data, char* line);
 	void Opcode_G_SETCOMBINE(uint64_t data, char* line);
 	void Opcode_G_SETPRIMCOLOR(uint64_t data, char* line);
 	void Opcode_G_SETOTHERMODE_L(uint64_t data, char* line);
 	void Opcode_G_SETOTHERMODE_H(uint64_t data, char* line);
-	void Opcode_G_LOADTLUT(uint64_t data, std::string prefix, char* line);
-	void Opcode_G_ENDDL(std::string prefix, char* line);
+	void Opcode_G_LOADTLUT(uint64_t data, const std::string& prefix, char* line);
+	void Opcode_G_ENDDL(const std::string& prefix, char* line);
 
 public:
 	std::string sceneSegName;
@@ -336,9 +389,16 @@ public:
 
 	DListType dListType;
 
-	std::map<uint32_t, std::vector<ZVtx>> vertices;
+	std::map<uint32_t, std::vector<VtxEntry>> vertices;
 	std::map<uint32_t, std::string> vtxDeclarations;
-	std::vector<ZDisplayList*> otherDLists;
+	std::vector<ZDisplayList*> otherDLists;  // Owned by the parent ZFile
+	DListStats stats;  // Only filled when `-dls` is used
+	bool wasSourceOutputGenerated = false;
+
+	// Filled by PredecodeGfxDis and consumed by the next ProcessGfxDis
+	bool isGfxdPredecoded = false;
+	std::string gfxdRecordedOutput;
+	std::vector<GfxdEvent> gfxdEvents;
 
 	ZTexture* lastTexture = nullptr;
 	ZTexture* lastTlut = nullptr;
@@ -363,14 +423,20 @@ public:
 	                            int32_t texHeight, uint32_t texAddr, uint32_t texSeg,
 	                            F3DZEXTexFormats texFmt, F3DZEXTexSizes texSiz, bool texLoaded,
 	                            bool texIsPalette, ZDisplayList* self);
-	static int32_t GetDListLength(const std::vector<uint8_t>& rawData, uint32_t rawDataIndex,
-	                              DListType dListType);
+	static ZTexture* DeclareSceneTexture(ZRoom* scene, uint32_t texAddr, int32_t texWidth,
+	                                     int32_t texHeight, TextureType texType, bool texIsPalette);
 
 	size_t GetRawDataSize() const override;
 	std::string GetSourceOutputHeader(const std::string& prefix) override;
 	std::string GetSourceOutputCode(const std::string& prefix) override;
+	void MergeVertexLists();
+	void CollectInstructionStats();
 	std::string ProcessLegacy(const std::string& prefix);
 	std::string ProcessGfxDis(const std::string& prefix);
+	void PredecodeGfxDis();
+	static void PredecodeDisplayLists(const std::vector<ZDisplayList*>& dLists);
+	void SetupGfxd();
+	void ReplayGfxdEvents(OutputFormatter& outputformatter);
 
 	virtual void GenerateHLIntermediette(HLFileIntermediette& hlFile) override;
 	bool IsExternalResource() const override;
@@ -1,6 +1,7 @@
 #include "ZFile.h"
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <unordered_set>
 #include "Directory.h"
 #include "File.h"
@@ -68,6 +69,11 @@ ZFile::~ZFile()
 	{
 		delete d.second;
 	}
+
+	for (auto dList : displayLists)
+	{
+		delete dList.second;
+	}
 }
 
 void ZFile::ParseXML(ZFileMode mode, XMLElement* reader, std::string filename, bool placeholderMode)
@@ -317,6 +323,7 @@ Declaration* ZFile::AddDeclaration(uint32_t address, DeclarationAlignment alignm
 {
 	assert(GETSEGNUM(address) == 0);
 	AddDeclarationDebugChecks(address);
+	declaredSize += size;
 
 	Declaration* decl = new Declaration(alignment, size, varType, varName, false, body);
 	declarations[address] = decl;
@@ -329,6 +336,7 @@ Declaration* ZFile::AddDeclaration(uint32_t address, DeclarationAlignment alignm
 {
 	assert(GETSEGNUM(address) == 0);
 	AddDeclarationDebugChecks(address);
+	declaredSize += size;
 
 	declarations[address] =
 		new Declaration(alignment, padding, size, varType, varName, false, body);
@@ -341,6 +349,7 @@ Declaration* ZFile::AddDeclarationArray(uint32_t address, DeclarationAlignment a
 {
 	assert(GETSEGNUM(address) == 0);
 	AddDeclarationDebugChecks(address);
+	declaredSize += size;
 
 	declarations[address] =
 		new Declaration(alignment, size, varType, varName, true, arrayItemCnt, body);
@@ -353,6 +362,7 @@ Declaration* ZFile::AddDeclarationArray(uint32_t address, DeclarationAlignment a
 {
 	assert(GETSEGNUM(address) == 0);
 	AddDeclarationDebugChecks(address);
+	declaredSize += size;
 
 	declarations[address] =
 		new Declaration(alignment, size, varType, varName, true, arrayItemCntStr, body);
@@ -365,6 +375,7 @@ Declaration* ZFile::AddDeclarationArray(uint32_t address, DeclarationAlignment a
 {
 	assert(GETSEGNUM(address) == 0);
 	AddDeclarationDebugChecks(address);
+	declaredSize += size;
 
 	declarations[address] =
 		new Declaration(alignment, size, varType, varName, true, arrayItemCnt, body, isExternal);
@@ -378,6 +389,7 @@ Declaration* ZFile::AddDeclarationArray(uint32_t address, DeclarationAlignment a
 {
 	assert(GETSEGNUM(address) == 0);
 	AddDeclarationDebugChecks(address);
+	declaredSize += size;
 
 	declarations[address] =
 		new Declaration(alignment, padding, size, varType, varName, true, arrayItemCnt, body);
@@ -425,6 +437,7 @@ Declaration* ZFile::AddDeclarationInclude(uint32_t address, std::string includeP
 {
 	assert(GETSEGNUM(address) == 0);
 	AddDeclarationDebugChecks(address);
+	declaredSize += size;
 
 	if (declarations.find(address) == declarations.end())
 		declarations[address] = new Declaration(includePath, size, varType, varName);
@@ -445,6 +458,7 @@ Declaration* ZFile::AddDeclarationIncludeArray(uint32_t address, std::string inc
 		includePath = "assets/" + StringHelper::Split(includePath, "assets/custom/")[1];
 
 	auto declCheck = declarations.find(address);
+	declaredSize += size;
 
 	if (declCheck != declarations.end())
 	{
@@ -547,6 +561,19 @@ bool ZFile::HasDeclaration(uint32_t address)
 	return declarations.find(address) != declarations.end();
 }
 
+void ZFile::PredecodeDisplayLists()
+{
+	std::vector<ZDisplayList*> dLists;
+
+	for (ZResource* res : resources)
+	{
+		if (res->GetResourceType() == ZResourceType::DisplayList)
+			dLists.push_back(static_cast<ZDisplayList*>(res));
+	}
+
+	ZDisplayList::PredecodeDisplayLists(dLists);
+}
+
 void ZFile::GenerateSourceFiles(fs::path outputDir)
 {
 	std::string sourceOutput = "";
@@ -558,6 +585,8 @@ void ZFile::GenerateSourceFiles(fs::path outputDir)
 
 	GeneratePlaceholderDeclarations();
 
+	PredecodeDisplayLists();
+
 	// Generate Code
 	for (size_t i = 0; i < resources.size(); i++)
 	{
@@ -579,16 +608,20 @@ void ZFile::GenerateSourceFiles(fs::path outputDir)
 			{
 				ZTexture* tex = static_cast<ZTexture*>(res);
 
-				if (!Globals::Instance->cfg.texturePool.empty())
+				if (!Globals::Instance->cfg.texturePool.empty() ||
+				    Globals::Instance->dedupTextures)
 				{
 					tex->CalcHash();
 
+					if (Globals::Instance->dedupTextures)
+						tex->AddToTexturePool(outputDir);
+
 					// TEXTURE POOL CHECK
-					if (Globals::Instance->cfg.texturePool.find(tex->hash) !=
-					    Globals::Instance->cfg.texturePool.end())
+					TexturePoolEntry* poolEntry = tex->GetPoolEntry();
+					if (poolEntry != nullptr)
 					{
-						incStr = Globals::Instance->cfg.texturePool[tex->hash].path.string() + "." +
-								 res->GetExternalExtension() + ".inc";
+						incStr = poolEntry->path.string() + "." + res->GetExternalExtension() +
+						         ".inc";
 					}
 				}
 
@@ -623,8 +656,12 @@ void ZFile::GenerateSourceFiles(fs::path outputDir)
 	formatter.Write(sourceOutput);
 
 	File::WriteAllText(outPath, formatter.GetOutput());
+	AddOutputFile(outPath);
 
 	GenerateSourceHeaderFiles();
+
+	if (Globals::Instance->dlStatsPath != "")
+		Globals::Instance->dlStatsReport += GetDListStatsReport();
 }
 
 void ZFile::GenerateSourceHeaderFiles()
@@ -648,6 +685,7 @@ void ZFile::GenerateSourceHeaderFiles()
 		printf("Writing H file: %s\n", headerFilename.c_str());
 
 	File::WriteAllText(headerFilename, formatter.GetOutput());
+	AddOutputFile(headerFilename);
 }
 
 void ZFile::GenerateHLIntermediette()
@@ -700,6 +738,206 @@ ZTexture* ZFile::GetTextureResource(uint32_t offset) const
 	return nullptr;
 }
 
+static uint64_t GetDListTextureKey(int32_t segment, uint32_t offset, TextureType format)
+{
+	return ((uint64_t)(segment & 0xFF) << 40) | ((uint64_t)format << 32) | offset;
+}
+
+bool ZFile::GetDListTexture(int32_t segment, uint32_t offset, TextureType format,
+                            ZTexture*& tex) const
+{
+	auto entry = dListTextures.find(GetDListTextureKey(segment, offset, format));
+	if (entry == dListTextures.end())
+		return false;
+
+	tex = entry->second;
+	return true;
+}
+
+void ZFile::AddDListTexture(int32_t segment, uint32_t offset, TextureType format, ZTexture* tex)
+{
+	dListTextures[GetDListTextureKey(segment, offset, format)] = tex;
+}
+
+void ZFile::AddSceneTextureRef(const SceneTextureRef& ref)
+{
+	// Only the first use matters, the later ones find the texture already declared
+	if (sceneTextureRefKeys.insert(GetDListTextureKey(SEGMENT_SCENE, ref.offset, ref.format)).second)
+		sceneTextureRefs.push_back(ref);
+}
+
+const std::vector<SceneTextureRef>& ZFile::GetSceneTextureRefs() const
+{
+	return sceneTextureRefs;
+}
+
+void ZFile::AddOutputFile(const fs::path& filePath)
+{
+	outputFiles.push_back(filePath);
+}
+
+const std::vector<fs::path>& ZFile::GetOutputFiles() const
+{
+	return outputFiles;
+}
+
+size_t ZFile::GetDeclaredSize() const
+{
+	return declaredSize;
+}
+
+ZDisplayList* ZFile::GetOrCreateDisplayList(uint32_t offset)
+{
+	auto dList = displayLists.find(offset);
+	if (dList != displayLists.end())
+		return dList->second;
+
+	DListType dListType =
+		Globals::Instance->game == ZGame::OOT_SW97 ? DListType::F3DEX : DListType::F3DZEX;
+	ZDisplayList* newDList = new ZDisplayList(offset, GetDListLength(offset, dListType), this);
+	displayLists[offset] = newDList;
+
+	return newDList;
+}
+
+int32_t ZFile::GetDListLength(uint32_t offset, DListType dListType)
+{
+	uint8_t endDLOpcode;
+
+	if (dListType == DListType::F3DZEX)
+		endDLOpcode = (uint8_t)F3DZEXOpcode::G_ENDDL;
+	else
+		endDLOpcode = (uint8_t)F3DEXOpcode::G_ENDDL;
+
+	auto indexIt = dListEndIndices.find(endDLOpcode);
+	if (indexIt == dListEndIndices.end())
+	{
+		// Build the index with a single pass over the whole file.
+		DListEndIndex& newIndex = dListEndIndices[endDLOpcode];
+		const uint8_t* data = rawData.data();
+		size_t size = rawData.size();
+		const void* found = memchr(data, endDLOpcode, size);
+
+		while (found != nullptr)
+		{
+			uint32_t foundOffset = static_cast<const uint8_t*>(found) - data;
+			newIndex.endOffsets[foundOffset % 8].push_back(foundOffset);
+			found = memchr(data + foundOffset + 1, endDLOpcode, size - foundOffset - 1);
+		}
+
+		indexIt = dListEndIndices.find(endDLOpcode);
+	}
+
+	DListEndIndex& index = indexIt->second;
+
+	auto length = index.lengths.find(offset);
+	if (length != index.lengths.end())
+		return length->second;
+
+	const std::vector<uint32_t>& endOffsets = index.endOffsets[offset % 8];
+	auto endOffset = std::lower_bound(endOffsets.begin(), endOffsets.end(), offset);
+
+	if (endOffset == endOffsets.end())
+	{
+		throw std::runtime_error(
+			StringHelper::Sprintf("ZFile::GetDListLength: Fatal error.\n"
+		                          "\t End of file found when trying to find the end of the "
+		                          "DisplayList at offset: '0x%X'.\n",
+		                          offset));
+	}
+
+	int32_t result = *endOffset + 8 - offset;
+	index.lengths[offset] = result;
+
+	return result;
+}
+
+void ZFile::AddDListStats(const DListStats& stats)
+{
+	dListStats.push_back(stats);
+}
+
+static int32_t GetDListDepth(const std::vector<DListStats>& dListStats,
+                             const std::map<uint32_t, size_t>& indices,
+                             std::map<uint32_t, int32_t>& depths, uint32_t offset)
+{
+	auto depth = depths.find(offset);
+	if (depth != depths.end())
+		return depth->second;
+
+	// Mark it as in progress so recursive display lists don't loop forever.
+	depths[offset] = 0;
+	int32_t result = 0;
+
+	auto index = indices.find(offset);
+	if (index != indices.end())
+	{
+		for (uint32_t child : dListStats[index->second].children)
+			result = std::max(result, GetDListDepth(dListStats, indices, depths, child) + 1);
+	}
+
+	depths[offset] = result;
+	return result;
+}
+
+std::string ZFile::GetDListStatsReport() const
+{
+	std::map<uint32_t, size_t> indices;
+	std::map<uint32_t, int32_t> depths;
+	std::vector<size_t> order;
+
+	for (size_t i = 0; i < dListStats.size(); i++)
+	{
+		indices[dListStats[i].offset] = i;
+		order.push_back(i);
+	}
+
+	// Slowest display lists first
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+		const DListStats& statsA = dListStats[a];
+		const DListStats& statsB = dListStats[b];
+		return statsA.parseTime + statsA.disassemblyTime + statsA.vertexTime >
+		       statsB.parseTime + statsB.disassemblyTime + statsB.vertexTime;
+	});
+
+	std::string output =
+		StringHelper::Sprintf("File %s (%zu display lists)\n", name.c_str(), dListStats.size());
+
+	for (size_t i : order)
+	{
+		const DListStats& stats = dListStats[i];
+
+		output += StringHelper::Sprintf("  %s (0x%06X)\n", stats.name.c_str(), stats.offset);
+		output +=
+			StringHelper::Sprintf("    instructions: %zu, nested depth: %i\n", stats.instructionCount,
+		                          GetDListDepth(dListStats, indices, depths, stats.offset));
+		output += StringHelper::Sprintf("    time (ms): parse %.3f, disassembly %.3f (textures "
+		                                "%.3f), vertices %.3f\n",
+		                                stats.parseTime, stats.disassemblyTime, stats.textureTime,
+		                                stats.vertexTime);
+		output += StringHelper::Sprintf("    vertex loads: %u (%u bytes)\n", stats.vertexLoads,
+		                                stats.vertexBytes);
+
+		output += "    texture loads:";
+		for (const auto& textureLoad : stats.textureLoads)
+			output += StringHelper::Sprintf(" %s x%u,", textureLoad.first.c_str(), textureLoad.second);
+		if (stats.textureLoads.empty())
+			output += " none";
+		else
+			output.pop_back();
+		output += "\n";
+
+		output += "    opcodes:";
+		for (const auto& opcodeCount : stats.opcodeCounts)
+			output += StringHelper::Sprintf(" 0x%02X x%u,", opcodeCount.first, opcodeCount.second);
+		if (!stats.opcodeCounts.empty())
+			output.pop_back();
+		output += "\n";
+	}
+
+	return output + "\n";
+}
+
 fs::path ZFile::GetSourceOutputFolderPath() const
 {
 	return Globals::Instance->sourceOutputPath / outName.parent_path();
@@ -1022,9 +1260,10 @@ std::string ZFile::ProcessDeclarations()
 					extType = "vtx";
 
 				auto filepath = Globals::Instance->outputPath / item.second->varName;
-				File::WriteAllText(
-					StringHelper::Sprintf("%s.%s.inc", filepath.c_str(), extType.c_str()),
-					item.second->text);
+				std::string incPath =
+					StringHelper::Sprintf("%s.%s.inc", filepath.c_str(), extType.c_str());
+				File::WriteAllText(incPath, item.second->text);
+				AddOutputFile(incPath);
 			}
 
 			// Do not asm_process vertex arrays. They have no practical use being overridden.
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "Directory.h"
 #include "ZResource.h"
@@ -16,6 +18,7 @@ enum class ZFileMode
 	BuildBlob,
 	BuildSourceFile,
 	BuildBackground,
+	BuildManifest,
 	Extract,
 	Invalid
 };
@@ -27,6 +30,46 @@ enum class ZGame
 	MM_RETAIL
 };
 
+class ZDisplayList;
+enum class DListType;
+
+// Offsets of every byte in the file that could be a G_ENDDL, one sorted list for each alignment
+// (offset % 8), so finding the end of a display list is a binary search instead of a walk through
+// its instructions.
+struct DListEndIndex
+{
+	std::vector<uint32_t> endOffsets[8];
+	std::map<uint32_t, int32_t> lengths;  // Already found lengths, keyed by display list offset
+};
+
+// Collected for every display list when `-dls` is used. Times are in milliseconds.
+struct DListStats
+{
+	std::string name;
+	uint32_t offset = 0;
+	size_t instructionCount = 0;
+	std::map<uint8_t, uint32_t> opcodeCounts;
+	uint32_t vertexLoads = 0;
+	uint32_t vertexBytes = 0;
+	std::map<std::string, uint32_t> textureLoads;  // Keyed by format and size
+	std::vector<uint32_t> children;  // Offsets of the display lists it calls or branches to
+	double parseTime = 0;
+	double disassemblyTime = 0;  // Includes textureTime
+	double textureTime = 0;
+	double vertexTime = 0;
+};
+
+// A texture from the scene's segment used by a room's display list. Recorded when `-rc` is used, so
+// the scene still declares it when the room itself is skipped.
+struct SceneTextureRef
+{
+	uint32_t offset = 0;
+	int32_t width = 0;
+	int32_t height = 0;
+	TextureType format = TextureType::Error;
+	bool isPalette = false;
+};
+
 class ZFile
 {
 public:
@@ -75,6 +118,7 @@ public:
 	Declaration* AddDeclarationIncludeArray(uint32_t address, std::string includePath, size_t size,
 	                                        std::string varType, std::string varName,
 	                                        size_t arrayItemCnt);
+	size_t GetDeclaredSize() const;
 	std::string GetDeclarationName(uint32_t address) const;
 	std::string GetDeclarationName(uint32_t address, std::string defaultResult) const;
 	std::string GetDeclarationPtrName(segptr_t segAddress) const;
@@ -87,6 +131,17 @@ public:
 
 	void AddTextureResource(uint32_t offset, ZTexture* tex);
 	ZTexture* GetTextureResource(uint32_t offset) const;
+	bool GetDListTexture(int32_t segment, uint32_t offset, TextureType format,
+	                     ZTexture*& tex) const;
+	void AddDListTexture(int32_t segment, uint32_t offset, TextureType format, ZTexture* tex);
+	ZDisplayList* GetOrCreateDisplayList(uint32_t offset);
+	int32_t GetDListLength(uint32_t offset, DListType dListType);
+	void AddDListStats(const DListStats& stats);
+	std::string GetDListStatsReport() const;
+	void AddSceneTextureRef(const SceneTextureRef& ref);
+	const std::vector<SceneTextureRef>& GetSceneTextureRefs() const;
+	void AddOutputFile(const fs::path& filePath);
+	const std::vector<fs::path>& GetOutputFiles() const;
 
 	fs::path GetSourceOutputFolderPath() const;
 
@@ -103,11 +158,24 @@ protected:
 	// The pointers declared here are "borrowed" (somebody else is the owner),
 	// so ZFile shouldn't delete/free those textures.
 	std::map<uint32_t, ZTexture*> texturesResources;
+	// Textures already handled by TextureGenCheck, keyed by segment, offset and format. nullptr
+	// when the address was already declared as something else.
+	std::unordered_map<uint64_t, ZTexture*> dListTextures;
+	// Display lists found while disassembling other display lists, limbs or meshes, keyed by
+	// offset so each one is parsed and declared only once. These are owned by the ZFile.
+	std::map<uint32_t, ZDisplayList*> displayLists;
+	std::map<uint8_t, DListEndIndex> dListEndIndices;  // Keyed by the G_ENDDL opcode
+	std::vector<DListStats> dListStats;
+	std::vector<SceneTextureRef> sceneTextureRefs;  // Only the first use of each texture
+	std::unordered_set<uint64_t> sceneTextureRefKeys;
+	std::vector<fs::path> outputFiles;  // Every file written while extracting this one
+	size_t declaredSize = 0;  // Bytes added by every AddDeclaration*, overwritten ones included
 
 	ZFile();
 	void ParseXML(ZFileMode mode, tinyxml2::XMLElement* reader, std::string filename,
 	              bool placeholderMode);
 	void DeclareResourceSubReferences();
+	void PredecodeDisplayLists();
 	void GenerateSourceFiles(fs::path outputDir);
 	void GenerateSourceHeaderFiles();
 	void GenerateHLIntermediette();
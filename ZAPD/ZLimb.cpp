@@ -235,11 +235,6 @@ Struct_800A5E28::Struct_800A5E28(ZFile* parent, const std::vector<uint8_t>& nRaw
 	}
 }
 
-Struct_800A5E28::~Struct_800A5E28()
-{
-	delete unk_8_dlist;
-}
-
 void Struct_800A5E28::PreGenSourceFiles(const std::string& prefix)
 {
 	if (unk_4 != 0)
@@ -281,10 +276,7 @@ void Struct_800A5E28::PreGenSourceFiles(const std::string& prefix)
 	{
 		uint32_t unk_8_Offset = Seg2Filespace(unk_8, parent->baseAddress);
 
-		int32_t dlistLength = ZDisplayList::GetDListLength(
-			parent->GetRawData(), unk_8_Offset,
-			Globals::Instance->game == ZGame::OOT_SW97 ? DListType::F3DEX : DListType::F3DZEX);
-		unk_8_dlist = new ZDisplayList(unk_8_Offset, dlistLength, parent);
+		unk_8_dlist = parent->GetOrCreateDisplayList(unk_8_Offset);
 
 		std::string dListStr =
 			StringHelper::Sprintf("%sSkinLimbDL_%06X", prefix.c_str(), unk_8_Offset);
@@ -604,10 +596,7 @@ std::string ZLimb::GetLimbDListSourceOutputCode(const std::string& prefix,
 	std::string dListStr =
 		StringHelper::Sprintf("%s%sLimbDL_%06X", prefix.c_str(), limbPrefix.c_str(), dListOffset);
 
-	int32_t dlistLength = ZDisplayList::GetDListLength(
-		parent->GetRawData(), dListOffset,
-		Globals::Instance->game == ZGame::OOT_SW97 ? DListType::F3DEX : DListType::F3DZEX);
-	auto dList = new ZDisplayList(dListOffset, dlistLength, parent);
+	auto dList = parent->GetOrCreateDisplayList(dListOffset);
 	dList->SetName(dListStr);
 	dList->GetSourceOutputCode(prefix);
 	return dListStr;
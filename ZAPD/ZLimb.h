@@ -100,14 +100,13 @@ protected:
 	segptr_t unk_8;  // Gfx*
 
 	std::vector<Struct_800A598C> unk_4_arr;
-	ZDisplayList* unk_8_dlist = nullptr;
+	ZDisplayList* unk_8_dlist = nullptr;  // Owned by the parent ZFile
 
 public:
 	Struct_800A5E28() = default;
 	Struct_800A5E28(ZFile* parent, const std::vector<uint8_t>& rawData, uint32_t fileOffset);
 	Struct_800A5E28(ZFile* parent, const std::vector<uint8_t>& rawData, uint32_t fileOffset,
 	                size_t index);
-	~Struct_800A5E28();
 
 	void PreGenSourceFiles(const std::string& prefix);
 	[[nodiscard]] std::string GetSourceOutputCode(const std::string& prefix) const;
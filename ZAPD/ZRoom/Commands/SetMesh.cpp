@@ -51,7 +51,8 @@ void SetMesh::DeclareReferences(const std::string& prefix)
 
 void GenDListDeclarations(ZRoom* zRoom, ZFile* parent, ZDisplayList* dList)
 {
-	if (dList == nullptr)
+	// Display lists shared between meshes (or referenced more than once) are declared only once.
+	if (dList == nullptr || dList->wasSourceOutputGenerated)
 	{
 		return;
 	}
@@ -143,15 +144,26 @@ void PolygonDlist::ParseRawData()
 		xlu = BitConverter::ToUInt32BE(rawData, rawDataIndex + 4);
 		break;
 	}
+
+	opaDList = MakeDlist(opa);
+	xluDList = MakeDlist(xlu);
 }
 
 void PolygonDlist::DeclareReferences(const std::string& prefix)
 {
-	opaDList = MakeDlist(opa, prefix);
-	xluDList = MakeDlist(xlu, prefix);
+	GenDListDeclarations(zRoom, parent, opaDList);
+	GenDListDeclarations(zRoom, parent, xluDList);
 }
 
-ZDisplayList* PolygonDlist::MakeDlist(segptr_t ptr, const std::string& prefix)
+void PolygonDlist::GetDisplayLists(std::vector<ZDisplayList*>& dLists) const
+{
+	if (opaDList != nullptr)
+		dLists.push_back(opaDList);
+	if (xluDList != nullptr)
+		dLists.push_back(xluDList);
+}
+
+ZDisplayList* PolygonDlist::MakeDlist(segptr_t ptr)
 {
 	if (ptr == 0)
 	{
@@ -160,13 +172,7 @@ ZDisplayList* PolygonDlist::MakeDlist(segptr_t ptr, const std::string& prefix)
 
 	uint32_t dlistAddress = Seg2Filespace(ptr, parent->baseAddress);
 
-	int32_t dlistLength = ZDisplayList::GetDListLength(
-		parent->GetRawData(), dlistAddress,
-		Globals::Instance->game == ZGame::OOT_SW97 ? DListType::F3DEX : DListType::F3DZEX);
-	ZDisplayList* dlist = new ZDisplayList(dlistAddress, dlistLength, parent);
-	GenDListDeclarations(zRoom, parent, dlist);
-
-	return dlist;
+	return parent->GetOrCreateDisplayList(dlistAddress);
 }
 
 size_t PolygonDlist::GetRawDataSize() const
@@ -438,6 +444,16 @@ void PolygonTypeBase::DeclareAndGenerateOutputCode(const std::string& prefix)
 	}
 }
 
+void PolygonTypeBase::PredecodeDisplayLists()
+{
+	std::vector<ZDisplayList*> dLists;
+
+	for (const PolygonDlist& polyDList : polyDLists)
+		polyDList.GetDisplayLists(dLists);
+
+	ZDisplayList::PredecodeDisplayLists(dLists);
+}
+
 std::string PolygonTypeBase::GetSourceTypeName() const
 {
 	switch (type)
@@ -494,9 +510,13 @@ void PolygonType1::ParseRawData()
 		                         Seg2Filespace(dlist, parent->baseAddress), parent, zRoom);
 		polyGfxList.SetPolyType(type);
 		polyGfxList.ParseRawData();
-		polyGfxList.DeclareReferences(zRoom->GetName());
 		polyDLists.push_back(polyGfxList);
 	}
+
+	PredecodeDisplayLists();
+
+	for (PolygonDlist& polyGfxList : polyDLists)
+		polyGfxList.DeclareReferences(zRoom->GetName());
 }
 
 void PolygonType1::DeclareReferences(const std::string& prefix)
@@ -624,10 +644,15 @@ void PolygonType2::ParseRawData()
 		PolygonDlist entry(zRoom->GetName(), rawData, currentPtr, parent, zRoom);
 		entry.SetPolyType(type);
 		entry.ParseRawData();
-		entry.DeclareReferences(zRoom->GetName());
 		polyDLists.push_back(entry);
 		currentPtr += entry.GetRawDataSize();
 	}
+
+	PredecodeDisplayLists();
+
+	// Declared in the same order as the entries, no matter which display list finished first
+	for (PolygonDlist& entry : polyDLists)
+		entry.DeclareReferences(zRoom->GetName());
 }
 
 void PolygonType2::DeclareReferences(const std::string& prefix)
@@ -14,6 +14,7 @@ public:
 
 	void ParseRawData();
 	void DeclareReferences(const std::string& prefix);
+	void GetDisplayLists(std::vector<ZDisplayList*>& dLists) const;
 
 	size_t GetRawDataSize() const;
 	void SetPolyType(uint8_t nPolyType);
@@ -44,7 +45,7 @@ protected:
 	ZRoom* zRoom;
 	std::string name;
 
-	ZDisplayList* MakeDlist(segptr_t ptr, const std::string& prefix);
+	ZDisplayList* MakeDlist(segptr_t ptr);
 };
 
 class BgImage
@@ -116,6 +117,8 @@ protected:
 	ZFile* parent;
 	ZRoom* zRoom;
 	std::string name;
+
+	void PredecodeDisplayLists();
 };
 
 class PolygonType1 : public PolygonTypeBase
@@ -10,9 +10,9 @@ class ZNames
 public:
 	static std::string GetObjectName(size_t id)
 	{
-		if (id >= Globals::Instance->cfg.objectList.size())
+		if (id >= Globals::Instance->cfg.objectList.GetCount())
 			return StringHelper::Sprintf("0x%04X", id);
-		return Globals::Instance->cfg.objectList.at(id);
+		return Globals::Instance->cfg.objectList.GetName(id);
 	}
 
 	static std::string GetActorName(int32_t id)
@@ -22,7 +22,7 @@ public:
 		case ZGame::OOT_RETAIL:
 		case ZGame::OOT_SW97:
 			if (id < ZNames::GetNumActors())
-				return Globals::Instance->cfg.actorList.at(id);
+				return Globals::Instance->cfg.actorList.GetName(id);
 			else
 				return StringHelper::Sprintf("0x%04X", id);
 		case ZGame::MM_RETAIL:
@@ -31,7 +31,7 @@ public:
 			id &= 0xFFF;
 			std::string name = "";
 			if (id < ZNames::GetNumActors())
-				name = Globals::Instance->cfg.actorList.at(id);
+				name = Globals::Instance->cfg.actorList.GetName(id);
 			else
 				name = StringHelper::Sprintf("0x%04X", id);
 
@@ -45,5 +45,5 @@ public:
 		return "";
 	}
 
-	static int32_t GetNumActors() { return Globals::Instance->cfg.actorList.size(); }
+	static int32_t GetNumActors() { return Globals::Instance->cfg.actorList.GetCount(); }
 };
@@ -1,6 +1,7 @@
 #include "ZRoom.h"
 #include <Path.h>
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include "../File.h"
 #include "../Globals.h"
@@ -49,13 +50,18 @@ REGISTER_ZFILENODE(Scene, ZRoom);
 
 ZRoom::ZRoom(ZFile* nParent) : ZResource(nParent)
 {
+	scene = nullptr;
 	roomCount = -1;
 	canHaveInner = true;
 	RegisterOptionalAttribute("HackMode");
+	RegisterOptionalAttribute("Scene");
 }
 
 ZRoom::~ZRoom()
 {
+	if (scene == this)
+		Globals::Instance->RemoveScene(this);
+
 	for (ZRoomCommand* cmd : commands)
 		delete cmd;
 }
@@ -64,13 +70,26 @@ void ZRoom::ExtractFromXML(tinyxml2::XMLElement* reader, uint32_t nRawDataIndex)
 {
 	ZResource::ExtractFromXML(reader, nRawDataIndex);
 
-	scene = Globals::Instance->lastScene;
-
 	if (std::string(reader->Name()) == "Scene")
 	{
 		scene = this;
-		Globals::Instance->lastScene = this;
+		Globals::Instance->AddScene(this);
+	}
+	else if (registeredAttributes.at("Scene").wasSet)
+	{
+		const std::string& sceneName = registeredAttributes.at("Scene").value;
+		scene = Globals::Instance->FindScene(sceneName);
+
+		if (scene == nullptr)
+		{
+			throw std::runtime_error(
+				StringHelper::Sprintf("ZRoom::ExtractFromXML: Fatal error in '%s'.\n"
+			                          "\t Scene '%s' hasn't been declared before this room.\n",
+			                          name.c_str(), sceneName.c_str()));
+		}
 	}
+	else
+		scene = Globals::Instance->lastScene;
 
 	uint32_t cmdCount = UINT32_MAX;
 
@@ -97,10 +116,9 @@ void ZRoom::ExtractFromXML(tinyxml2::XMLElement* reader, uint32_t nRawDataIndex)
 
 			ZDisplayList* dList = new ZDisplayList(
 				address,
-				ZDisplayList::GetDListLength(parent->GetRawData(), address,
-			                                 Globals::Instance->game == ZGame::OOT_SW97 ?
-                                                 DListType::F3DEX :
-                                                 DListType::F3DZEX),
+				parent->GetDListLength(address, Globals::Instance->game == ZGame::OOT_SW97 ?
+                                                    DListType::F3DEX :
+                                                    DListType::F3DZEX),
 				parent);
 			dList->SetInnerNode(true);
 
@@ -165,6 +183,77 @@ void ZRoom::ExtractFromXML(tinyxml2::XMLElement* reader, uint32_t nRawDataIndex)
 	ProcessCommandSets();
 }
 
+template <typename T>
+static ZRoomCommand* MakeRoomCommand(ZFile* parent)
+{
+	return new T(parent);
+}
+
+// Indexed by opcode. MM reuses the OoT opcodes and adds its own after SetCameraSettings. The `mm`
+// constructor is only set for the opcodes which mean something else in MM.
+static const std::array<ZRoom::RoomCommandFactory, 0x1F> roomCommandFactories = {{
+	{MakeRoomCommand<SetStartPositionList>},  // 0x00
+	{MakeRoomCommand<SetActorList>},  // 0x01
+	{MakeRoomCommand<SetCsCamera>},  // 0x02 (MM-ONLY)
+	{MakeRoomCommand<SetCollisionHeader>},  // 0x03
+	{MakeRoomCommand<SetRoomList>},  // 0x04
+	{MakeRoomCommand<SetWind>},  // 0x05
+	{MakeRoomCommand<SetEntranceList>},  // 0x06
+	{MakeRoomCommand<SetSpecialObjects>},  // 0x07
+	{MakeRoomCommand<SetRoomBehavior>},  // 0x08
+	{MakeRoomCommand<Unused09>},  // 0x09
+	{MakeRoomCommand<SetMesh>},  // 0x0A
+	{MakeRoomCommand<SetObjectList>},  // 0x0B
+	{MakeRoomCommand<SetLightList>},  // 0x0C (MM-ONLY)
+	{MakeRoomCommand<SetPathways>},  // 0x0D
+	{MakeRoomCommand<SetTransitionActorList>},  // 0x0E
+	{MakeRoomCommand<SetLightingSettings>},  // 0x0F
+	{MakeRoomCommand<SetTimeSettings>},  // 0x10
+	{MakeRoomCommand<SetSkyboxSettings>},  // 0x11
+	{MakeRoomCommand<SetSkyboxModifier>},  // 0x12
+	{MakeRoomCommand<SetExitList>},  // 0x13
+	{MakeRoomCommand<EndMarker>},  // 0x14
+	{MakeRoomCommand<SetSoundSettings>},  // 0x15
+	{MakeRoomCommand<SetEchoSettings>},  // 0x16
+	{MakeRoomCommand<SetCutscenes>},  // 0x17
+	{MakeRoomCommand<SetAlternateHeaders>},  // 0x18
+	{MakeRoomCommand<SetCameraSettings>, MakeRoomCommand<SetWorldMapVisited>},  // 0x19
+	{MakeRoomCommand<SetAnimatedMaterialList>},  // 0x1A (MM-ONLY)
+	{MakeRoomCommand<SetActorCutsceneList>},  // 0x1B (MM-ONLY)
+	{MakeRoomCommand<SetMinimapList>},  // 0x1C (MM-ONLY)
+	{MakeRoomCommand<Unused1D>},  // 0x1D
+	{MakeRoomCommand<SetMinimapChests>},  // 0x1E (MM-ONLY)
+}};
+
+std::map<uint8_t, RoomCommandProfile> ZRoom::commandProfiles;
+
+ZRoomCommand* ZRoom::CreateCommand(RoomCommand opcode, ZFile* parent)
+{
+	size_t index = static_cast<size_t>(opcode);
+
+	if (index >= roomCommandFactories.size())
+		return new ZRoomCommandUnk(parent);
+
+	const RoomCommandFactory& factory = roomCommandFactories[index];
+
+	if (Globals::Instance->game == ZGame::MM_RETAIL && factory.mm != nullptr)
+		return factory.mm(parent);
+
+	return factory.oot(parent);
+}
+
+// Only used when profiling, to measure how much each command declares. Commands can declare in the
+// scene's file too.
+size_t ZRoom::GetDeclaredSize() const
+{
+	size_t size = parent->GetDeclaredSize();
+
+	if (scene != nullptr && scene != this && scene->parent != parent)
+		size += scene->parent->GetDeclaredSize();
+
+	return size;
+}
+
 void ZRoom::ParseCommands(std::vector<ZRoomCommand*>& commandList, CommandSet commandSet)
 {
 	bool shouldContinue = true;
@@ -181,112 +270,10 @@ void ZRoom::ParseCommands(std::vector<ZRoomCommand*>& commandList, CommandSet co
 
 		RoomCommand opcode = static_cast<RoomCommand>(rawData.at(rawDataIndex));
 
-		ZRoomCommand* cmd = nullptr;
-
+		size_t declaredSize = Globals::Instance->profile ? GetDeclaredSize() : 0;
 		auto start = std::chrono::steady_clock::now();
 
-		switch (opcode)
-		{
-		case RoomCommand::SetStartPositionList:
-			cmd = new SetStartPositionList(parent);
-			break;  // 0x00
-		case RoomCommand::SetActorList:
-			cmd = new SetActorList(parent);
-			break;  // 0x01
-		case RoomCommand::SetCsCamera:
-			cmd = new SetCsCamera(parent);
-			break;  // 0x02 (MM-ONLY)
-		case RoomCommand::SetCollisionHeader:
-			cmd = new SetCollisionHeader(parent);
-			break;  // 0x03
-		case RoomCommand::SetRoomList:
-			cmd = new SetRoomList(parent);
-			break;  // 0x04
-		case RoomCommand::SetWind:
-			cmd = new SetWind(parent);
-			break;  // 0x05
-		case RoomCommand::SetEntranceList:
-			cmd = new SetEntranceList(parent);
-			break;  // 0x06
-		case RoomCommand::SetSpecialObjects:
-			cmd = new SetSpecialObjects(parent);
-			break;  // 0x07
-		case RoomCommand::SetRoomBehavior:
-			cmd = new SetRoomBehavior(parent);
-			break;  // 0x08
-		case RoomCommand::Unused09:
-			cmd = new Unused09(parent);
-			break;  // 0x09
-		case RoomCommand::SetMesh:
-			cmd = new SetMesh(parent);
-			break;  // 0x0A
-		case RoomCommand::SetObjectList:
-			cmd = new SetObjectList(parent);
-			break;  // 0x0B
-		case RoomCommand::SetLightList:
-			cmd = new SetLightList(parent);
-			break;  // 0x0C (MM-ONLY)
-		case RoomCommand::SetPathways:
-			cmd = new SetPathways(parent);
-			break;  // 0x0D
-		case RoomCommand::SetTransitionActorList:
-			cmd = new SetTransitionActorList(parent);
-			break;  // 0x0E
-		case RoomCommand::SetLightingSettings:
-			cmd = new SetLightingSettings(parent);
-			break;  // 0x0F
-		case RoomCommand::SetTimeSettings:
-			cmd = new SetTimeSettings(parent);
-			break;  // 0x10
-		case RoomCommand::SetSkyboxSettings:
-			cmd = new SetSkyboxSettings(parent);
-			break;  // 0x11
-		case RoomCommand::SetSkyboxModifier:
-			cmd = new SetSkyboxModifier(parent);
-			break;  // 0x12
-		case RoomCommand::SetExitList:
-			cmd = new SetExitList(parent);
-			break;  // 0x13
-		case RoomCommand::EndMarker:
-			cmd = new EndMarker(parent);
-			break;  // 0x14
-		case RoomCommand::SetSoundSettings:
-			cmd = new SetSoundSettings(parent);
-			break;  // 0x15
-		case RoomCommand::SetEchoSettings:
-			cmd = new SetEchoSettings(parent);
-			break;  // 0x16
-		case RoomCommand::SetCutscenes:
-			cmd = new SetCutscenes(parent);
-			break;  // 0x17
-		case RoomCommand::SetAlternateHeaders:
-			cmd = new SetAlternateHeaders(parent);
-			break;  // 0x18
-		case RoomCommand::SetCameraSettings:
-			if (Globals::Instance->game == ZGame::MM_RETAIL)
-				cmd = new SetWorldMapVisited(parent);
-			else
-				cmd = new SetCameraSettings(parent);
-			break;  // 0x19
-		case RoomCommand::SetAnimatedMaterialList:
-			cmd = new SetAnimatedMaterialList(parent);
-			break;  // 0x1A (MM-ONLY)
-		case RoomCommand::SetActorCutsceneList:
-			cmd = new SetActorCutsceneList(parent);
-			break;  // 0x1B (MM-ONLY)
-		case RoomCommand::SetMinimapList:
-			cmd = new SetMinimapList(parent);
-			break;  // 0x1C (MM-ONLY)
-		case RoomCommand::Unused1D:
-			cmd = new Unused1D(parent);
-			break;  // 0x1D
-		case RoomCommand::SetMinimapChests:
-			cmd = new SetMinimapChests(parent);
-			break;  // 0x1E (MM-ONLY)
-		default:
-			cmd = new ZRoomCommandUnk(parent);
-		}
-
+		ZRoomCommand* cmd = CreateCommand(opcode, parent);
 		cmd->ExtractCommandFromRoom(this, rawDataIndex);
 		cmd->DeclareReferences(GetName());
 
@@ -296,6 +283,13 @@ void ZRoom::ParseCommands(std::vector<ZRoomCommand*>& commandList, CommandSet co
 			auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 			if (diff > 50)
 				printf("OP: %s, TIME: %lims\n", cmd->GetCommandCName().c_str(), diff);
+
+			RoomCommandProfile& profile = commandProfiles[static_cast<uint8_t>(opcode)];
+			profile.cmdName = cmd->GetCommandCName();
+			profile.count++;
+			profile.time += end - start;
+
+			profile.declaredSize += GetDeclaredSize() - declaredSize;
 		}
 
 		cmd->cmdIndex = currentIndex;
@@ -314,13 +308,30 @@ void ZRoom::ParseCommands(std::vector<ZRoomCommand*>& commandList, CommandSet co
 
 void ZRoom::ProcessCommandSets()
 {
-	while (commandSets.size() > 0)
+	while (!commandSets.empty())
 	{
+		CommandSet currentSet = commandSets.front();
+		commandSets.pop_front();
+
+		// Several alternate headers (or hints) can point to the same command set, but it is only
+		// parsed and declared again if this time it has more commands. An AltHeaderHint with a
+		// `Count` is queued before the headers, and must not hide the full set they point to.
+		auto parsedSet = parsedCommandSets.find(GETSEGOFFSET(currentSet.address));
+
+		if (parsedSet != parsedCommandSets.end())
+		{
+			if (parsedSet->second >= currentSet.commandCount)
+				continue;
+
+			parsedSet->second = currentSet.commandCount;
+		}
+		else
+			parsedCommandSets[GETSEGOFFSET(currentSet.address)] = currentSet.commandCount;
+
 		std::vector<ZRoomCommand*> setCommands = std::vector<ZRoomCommand*>();
 
-		int32_t commandSet = commandSets[0].address;
-		ParseCommands(setCommands, commandSets[0]);
-		commandSets.erase(commandSets.begin());
+		int32_t commandSet = currentSet.address;
+		ParseCommands(setCommands, currentSet);
 
 		for (auto& cmd : setCommands)
 		{
@@ -351,7 +362,10 @@ void ZRoom::ProcessCommandSets()
 			sourceOutput += "\n";
 
 			for (ZRoomCommand* cmd : setCommands)
+			{
+				cmd->roomIndex = commands.size();
 				commands.push_back(cmd);
+			}
 		}
 	}
 }
@@ -383,14 +397,14 @@ ZRoomCommand* ZRoom::FindCommandOfType(RoomCommand cmdType)
 	return nullptr;
 }
 
+// The declarations of a file are kept sorted by address, so the neighbor is just the next entry
 size_t ZRoom::GetDeclarationSizeFromNeighbor(uint32_t declarationAddress)
 {
 	auto currentDecl = parent->declarations.find(declarationAddress);
 	if (currentDecl == parent->declarations.end())
 		return 0;
 
-	auto nextDecl = currentDecl;
-	std::advance(nextDecl, 1);
+	auto nextDecl = std::next(currentDecl);
 	if (nextDecl == parent->declarations.end())
 		return parent->GetRawData().size() - currentDecl->first;
 
@@ -399,26 +413,15 @@ size_t ZRoom::GetDeclarationSizeFromNeighbor(uint32_t declarationAddress)
 
 size_t ZRoom::GetCommandSizeFromNeighbor(ZRoomCommand* cmd)
 {
-	int32_t cmdIndex = -1;
-
-	for (size_t i = 0; i < commands.size(); i++)
-	{
-		if (commands[i] == cmd)
-		{
-			cmdIndex = i;
-			break;
-		}
-	}
+	uint32_t cmdIndex = cmd->roomIndex;
 
-	if (cmdIndex != -1)
-	{
-		if (cmdIndex + 1 < (int32_t)commands.size())
-			return commands[cmdIndex + 1]->cmdAddress - commands[cmdIndex]->cmdAddress;
-		else
-			return parent->GetRawData().size() - commands[cmdIndex]->cmdAddress;
-	}
+	if (cmdIndex >= commands.size() || commands[cmdIndex] != cmd)
+		return 0;
 
-	return 0;
+	if (cmdIndex + 1 < commands.size())
+		return commands[cmdIndex + 1]->cmdAddress - commands[cmdIndex]->cmdAddress;
+	else
+		return parent->GetRawData().size() - commands[cmdIndex]->cmdAddress;
 }
 
 std::string ZRoom::GetSourceOutputHeader(const std::string& prefix)
@@ -464,6 +467,24 @@ void ZRoom::PreGenSourceFiles()
 		cmd->PreGenSourceFiles();
 }
 
+std::string ZRoom::GetCommandProfileReport()
+{
+	std::string output = "";
+
+	for (const auto& profilePair : commandProfiles)
+	{
+		const RoomCommandProfile& profile = profilePair.second;
+		auto time =
+			std::chrono::duration_cast<std::chrono::microseconds>(profile.time).count();
+
+		output += StringHelper::Sprintf(
+			"CMD: 0x%02X %s, COUNT: %zu, TIME: %.3fms, DECLARED: 0x%zX bytes\n", profilePair.first,
+			profile.cmdName.c_str(), profile.count, time / 1000.0, profile.declaredSize);
+	}
+
+	return output;
+}
+
 /* CommandSet */
 
 CommandSet::CommandSet(uint32_t nAddress, uint32_t nCommandCount)
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <deque>
 #include <map>
 #include <string>
 #include <vector>
@@ -16,6 +18,15 @@ struct CommandSet
 	CommandSet(uint32_t nAddress, uint32_t nCommandCount = UINT32_MAX);
 };
 
+// Aggregated over every room extracted, only filled when `-profile 1` is used
+struct RoomCommandProfile
+{
+	std::string cmdName;
+	size_t count = 0;
+	std::chrono::steady_clock::duration time = std::chrono::steady_clock::duration::zero();
+	size_t declaredSize = 0;
+};
+
 class ZRoom : public ZResource
 {
 protected:
@@ -25,10 +36,22 @@ protected:
 	std::string GetSourceOutputCode(const std::string& prefix) override;
 	void ProcessCommandSets();
 	void SyotesRoomHack();
+	size_t GetDeclaredSize() const;
 
 public:
+	typedef ZRoomCommand* (*RoomCommandCtor)(ZFile* parent);
+
+	struct RoomCommandFactory
+	{
+		RoomCommandCtor oot;
+		RoomCommandCtor mm = nullptr;
+	};
+
+	static std::map<uint8_t, RoomCommandProfile> commandProfiles;  // Key = Opcode
+
 	ZRoom* scene;
-	std::vector<CommandSet> commandSets;
+	std::deque<CommandSet> commandSets;  // Pending command sets, processed in order
+	std::map<uint32_t, uint32_t> parsedCommandSets;  // Key = Offset, Value = Command count
 	int32_t roomCount;  // Only valid for scenes
 
 	std::string extDefines;
@@ -38,6 +61,9 @@ public:
 
 	void ExtractFromXML(tinyxml2::XMLElement* reader, uint32_t nRawDataIndex) override;
 
+	static ZRoomCommand* CreateCommand(RoomCommand opcode, ZFile* parent);
+	static std::string GetCommandProfileReport();
+
 	void ParseCommands(std::vector<ZRoomCommand*>& commandList, CommandSet commandSet);
 	size_t GetDeclarationSizeFromNeighbor(uint32_t declarationAddress);
 	size_t GetCommandSizeFromNeighbor(ZRoomCommand* cmd);
@@ -54,7 +54,8 @@ class ZRoomCommand : public ZResource
 {
 public:
 	int32_t cmdAddress;
-	uint32_t cmdIndex;
+	uint32_t cmdIndex;  // Position in its command set
+	uint32_t roomIndex = UINT32_MAX;  // Position in ZRoom::commands, set once its set is processed
 	uint32_t commandSet;
 
 	ZRoomCommand(ZFile* nParent);
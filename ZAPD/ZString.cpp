@@ -1,5 +1,6 @@
 #include "ZString.h"
 
+#include <cstring>
 #include "File.h"
 #include "StringHelper.h"
 #include "ZFile.h"
@@ -12,26 +13,29 @@ ZString::ZString(ZFile* nParent) : ZResource(nParent)
 
 void ZString::ParseRawData()
 {
-	size_t size = 0;
 	const auto& rawData = parent->GetRawData();
-	const auto& rawDataArr = rawData.data();
-	size_t rawDataSize = rawData.size();
-	for (size_t i = rawDataIndex; i < rawDataSize; ++i)
+	size_t available = rawDataIndex < rawData.size() ? rawData.size() - rawDataIndex : 0;
+
+	// The parent keeps its raw data until it's destroyed, which outlives this string
+	strData = reinterpret_cast<const char*>(rawData.data()) + rawDataIndex;
+
+	const void* terminator = memchr(strData, '\0', available);
+
+	if (terminator != nullptr)
 	{
-		++size;
-		if (rawDataArr[i] == '\0')
-		{
-			break;
-		}
+		strLength = static_cast<const char*>(terminator) - strData;
+		strSize = strLength + 1;
+	}
+	else
+	{
+		strLength = available;
+		strSize = available;
 	}
-
-	auto dataStart = rawData.begin() + rawDataIndex;
-	strData.assign(dataStart, dataStart + size);
 }
 
 std::string ZString::GetBodySourceCode() const
 {
-	return StringHelper::Sprintf("\t\"%s\"", strData.data());
+	return StringHelper::Sprintf("\t\"%.*s\"", static_cast<int32_t>(strLength), strData);
 }
 
 std::string ZString::GetSourceOutputCode(const std::string& prefix)
@@ -44,7 +48,8 @@ std::string ZString::GetSourceOutputCode(const std::string& prefix)
 
 std::string ZString::GetSourceOutputHeader(const std::string& prefix)
 {
-	return StringHelper::Sprintf("#define %s_macro \"%s\"", name.c_str(), strData.data());
+	return StringHelper::Sprintf("#define %s_macro \"%.*s\"", name.c_str(),
+	                             static_cast<int32_t>(strLength), strData);
 }
 
 std::string ZString::GetSourceTypeName() const
@@ -59,5 +64,5 @@ ZResourceType ZString::GetResourceType() const
 
 size_t ZString::GetRawDataSize() const
 {
-	return strData.size();
+	return strSize;
 }
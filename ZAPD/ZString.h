@@ -19,5 +19,8 @@ public:
 	size_t GetRawDataSize() const override;
 
 protected:
-	std::vector<uint8_t> strData;
+	// Points into the parent's raw data
+	const char* strData = nullptr;
+	size_t strLength = 0;  // Without the null terminator
+	size_t strSize = 0;    // With the null terminator, if there is one
 };
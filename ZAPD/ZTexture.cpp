@@ -115,217 +115,277 @@ void ZTexture::ParseXML(tinyxml2::XMLElement* reader)
 }
 
 void ZTexture::ParseRawData()
+{
+	// The pixels are only decoded right before saving the PNG (see `PrepareBitmap`), so here we
+	// just make sure the texture fits in the file.
+	if (rawDataIndex + GetRawDataSize() > parent->GetRawData().size())
+	{
+		throw std::runtime_error(StringHelper::Sprintf(
+			"ZTexture::ParseRawData: Error in %s\n"
+			"\t Texture at offset 0x%06X with size 0x%X goes past the end of the file.\n",
+			name.c_str(), rawDataIndex, GetRawDataSize()));
+	}
+}
+
+void ZTexture::PrepareBitmap()
+{
+	switch (format)
+	{
+	case TextureType::RGBA16bpp:
+	case TextureType::RGBA32bpp:
+	case TextureType::GrayscaleAlpha4bpp:
+	case TextureType::GrayscaleAlpha8bpp:
+	case TextureType::GrayscaleAlpha16bpp:
+		textureData.InitStreamedRGBImage(width, height, true);
+		break;
+	case TextureType::Grayscale4bpp:
+	case TextureType::Grayscale8bpp:
+		textureData.InitStreamedRGBImage(width, height, false);
+		break;
+	case TextureType::Palette4bpp:
+	case TextureType::Palette8bpp:
+		textureData.InitStreamedPaletteImage(width, height);
+		PreparePalette();
+		break;
+	default:
+		throw std::runtime_error("Format is not supported!");
+	}
+}
+
+void ZTexture::PreparePalette()
+{
+	const auto& parentRawData = parent->GetRawData();
+
+	// Every index used by the texture gets a grayscale color, in case there's no TLUT (or the TLUT
+	// doesn't cover it).
+	for (size_t i = 0; i < GetRawDataSize(); i++)
+	{
+		uint8_t data = parentRawData.at(rawDataIndex + i);
+
+		if (format == TextureType::Palette4bpp)
+		{
+			uint8_t indexHi = (data & 0xF0) >> 4;
+			uint8_t indexLo = data & 0x0F;
+			textureData.SetPaletteIndex(indexHi, indexHi * 16, indexHi * 16, indexHi * 16, 255);
+			textureData.SetPaletteIndex(indexLo, indexLo * 16, indexLo * 16, indexLo * 16, 255);
+		}
+		else
+			textureData.SetPaletteIndex(data, data, data, data, 255);
+	}
+
+	if (tlut == nullptr)
+		return;
+
+	size_t tlutBytesPerPixel = 4;
+	if (tlut->format == TextureType::Grayscale4bpp || tlut->format == TextureType::Grayscale8bpp)
+		tlutBytesPerPixel = 3;
+
+	std::vector<uint8_t> tlutRow(tlut->width * tlutBytesPerPixel);
+	for (size_t y = 0; y < tlut->height; y++)
+	{
+		tlut->PrepareBitmapRow(y, tlutRow.data());
+
+		for (size_t x = 0; x < tlut->width; x++)
+		{
+			const uint8_t* color = tlutRow.data() + x * tlutBytesPerPixel;
+			uint8_t alpha = tlutBytesPerPixel == 4 ? color[3] : 255;
+
+			textureData.SetPaletteIndex(y * tlut->width + x, color[0], color[1], color[2], alpha);
+		}
+	}
+}
+
+void ZTexture::PrepareBitmapRow(size_t y, uint8_t* row) const
 {
 	switch (format)
 	{
 	case TextureType::RGBA16bpp:
-		PrepareBitmapRGBA16();
+		PrepareBitmapRowRGBA16(y, row);
 		break;
 	case TextureType::RGBA32bpp:
-		PrepareBitmapRGBA32();
+		PrepareBitmapRowRGBA32(y, row);
 		break;
 	case TextureType::Grayscale4bpp:
-		PrepareBitmapGrayscale4();
+		PrepareBitmapRowGrayscale4(y, row);
 		break;
 	case TextureType::Grayscale8bpp:
-		PrepareBitmapGrayscale8();
+		PrepareBitmapRowGrayscale8(y, row);
 		break;
 	case TextureType::GrayscaleAlpha4bpp:
-		PrepareBitmapGrayscaleAlpha4();
+		PrepareBitmapRowGrayscaleAlpha4(y, row);
 		break;
 	case TextureType::GrayscaleAlpha8bpp:
-		PrepareBitmapGrayscaleAlpha8();
+		PrepareBitmapRowGrayscaleAlpha8(y, row);
 		break;
 	case TextureType::GrayscaleAlpha16bpp:
-		PrepareBitmapGrayscaleAlpha16();
+		PrepareBitmapRowGrayscaleAlpha16(y, row);
 		break;
 	case TextureType::Palette4bpp:
-		PrepareBitmapPalette4();
+		PrepareBitmapRowPalette4(y, row);
 		break;
 	case TextureType::Palette8bpp:
-		PrepareBitmapPalette8();
+		PrepareBitmapRowPalette8(y, row);
 		break;
 	default:
 		throw std::runtime_error("Format is not supported!");
 	}
 }
 
-void ZTexture::PrepareBitmapRGBA16()
+void ZTexture::PrepareBitmapRowRGBA16(size_t y, uint8_t* row) const
 {
-	textureData.InitEmptyRGBImage(width, height, true);
-	auto parentRawData = parent->GetRawData();
-	for (size_t y = 0; y < height; y++)
+	const auto& parentRawData = parent->GetRawData();
+	for (size_t x = 0; x < width; x++)
 	{
-		for (size_t x = 0; x < width; x++)
-		{
-			int32_t pos = rawDataIndex + ((y * width) + x) * 2;
-			uint16_t data = parentRawData.at(pos + 1) | (parentRawData.at(pos) << 8);
-			uint8_t r = (data & 0xF800) >> 11;
-			uint8_t g = (data & 0x07C0) >> 6;
-			uint8_t b = (data & 0x003E) >> 1;
-			uint8_t alpha = data & 0x01;
-
-			textureData.SetRGBPixel(y, x, r * 8, g * 8, b * 8, alpha * 255);
-		}
+		int32_t pos = rawDataIndex + ((y * width) + x) * 2;
+		uint16_t data = parentRawData.at(pos + 1) | (parentRawData.at(pos) << 8);
+		uint8_t r = (data & 0xF800) >> 11;
+		uint8_t g = (data & 0x07C0) >> 6;
+		uint8_t b = (data & 0x003E) >> 1;
+		uint8_t alpha = data & 0x01;
+
+		row[x * 4 + 0] = r * 8;
+		row[x * 4 + 1] = g * 8;
+		row[x * 4 + 2] = b * 8;
+		row[x * 4 + 3] = alpha * 255;
 	}
 }
 
-void ZTexture::PrepareBitmapRGBA32()
+void ZTexture::PrepareBitmapRowRGBA32(size_t y, uint8_t* row) const
 {
-	textureData.InitEmptyRGBImage(width, height, true);
-	auto parentRawData = parent->GetRawData();
-	for (size_t y = 0; y < height; y++)
+	const auto& parentRawData = parent->GetRawData();
+	for (size_t x = 0; x < width; x++)
 	{
-		for (size_t x = 0; x < width; x++)
-		{
-			size_t pos = rawDataIndex + ((y * width) + x) * 4;
-			uint8_t r = parentRawData.at(pos + 0);
-			uint8_t g = parentRawData.at(pos + 1);
-			uint8_t b = parentRawData.at(pos + 2);
-			uint8_t alpha = parentRawData.at(pos + 3);
+		size_t pos = rawDataIndex + ((y * width) + x) * 4;
 
-			textureData.SetRGBPixel(y, x, r, g, b, alpha);
-		}
+		row[x * 4 + 0] = parentRawData.at(pos + 0);
+		row[x * 4 + 1] = parentRawData.at(pos + 1);
+		row[x * 4 + 2] = parentRawData.at(pos + 2);
+		row[x * 4 + 3] = parentRawData.at(pos + 3);
 	}
 }
 
-void ZTexture::PrepareBitmapGrayscale4()
+void ZTexture::PrepareBitmapRowGrayscale4(size_t y, uint8_t* row) const
 {
-	textureData.InitEmptyRGBImage(width, height, false);
-	auto parentRawData = parent->GetRawData();
-	for (size_t y = 0; y < height; y++)
+	const auto& parentRawData = parent->GetRawData();
+	for (size_t x = 0; x < width; x += 2)
 	{
-		for (size_t x = 0; x < width; x += 2)
+		for (uint8_t i = 0; i < 2; i++)
 		{
-			for (uint8_t i = 0; i < 2; i++)
-			{
-				size_t pos = rawDataIndex + ((y * width) + x) / 2;
-				uint8_t grayscale = 0;
+			size_t pos = rawDataIndex + ((y * width) + x) / 2;
+			uint8_t grayscale = 0;
 
-				if (i == 0)
-					grayscale = parentRawData.at(pos) & 0xF0;
-				else
-					grayscale = (parentRawData.at(pos) & 0x0F) << 4;
+			if (i == 0)
+				grayscale = parentRawData.at(pos) & 0xF0;
+			else
+				grayscale = (parentRawData.at(pos) & 0x0F) << 4;
 
-				textureData.SetGrayscalePixel(y, x + i, grayscale);
-			}
+			row[(x + i) * 3 + 0] = grayscale;
+			row[(x + i) * 3 + 1] = grayscale;
+			row[(x + i) * 3 + 2] = grayscale;
 		}
 	}
 }
 
-void ZTexture::PrepareBitmapGrayscale8()
+void ZTexture::PrepareBitmapRowGrayscale8(size_t y, uint8_t* row) const
 {
-	textureData.InitEmptyRGBImage(width, height, false);
-	auto parentRawData = parent->GetRawData();
-	for (size_t y = 0; y < height; y++)
+	const auto& parentRawData = parent->GetRawData();
+	for (size_t x = 0; x < width; x++)
 	{
-		for (size_t x = 0; x < width; x++)
-		{
-			size_t pos = rawDataIndex + ((y * width) + x) * 1;
+		size_t pos = rawDataIndex + ((y * width) + x) * 1;
+		uint8_t grayscale = parentRawData.at(pos);
 
-			textureData.SetGrayscalePixel(y, x, parentRawData.at(pos));
-		}
+		row[x * 3 + 0] = grayscale;
+		row[x * 3 + 1] = grayscale;
+		row[x * 3 + 2] = grayscale;
 	}
 }
 
-void ZTexture::PrepareBitmapGrayscaleAlpha4()
+void ZTexture::PrepareBitmapRowGrayscaleAlpha4(size_t y, uint8_t* row) const
 {
-	textureData.InitEmptyRGBImage(width, height, true);
-	auto parentRawData = parent->GetRawData();
-	for (size_t y = 0; y < height; y++)
+	const auto& parentRawData = parent->GetRawData();
+	for (size_t x = 0; x < width; x += 2)
 	{
-		for (size_t x = 0; x < width; x += 2)
+		for (uint16_t i = 0; i < 2; i++)
 		{
-			for (uint16_t i = 0; i < 2; i++)
-			{
-				size_t pos = rawDataIndex + ((y * width) + x) / 2;
-				uint8_t data = 0;
+			size_t pos = rawDataIndex + ((y * width) + x) / 2;
+			uint8_t data = 0;
 
-				if (i == 0)
-					data = (parentRawData.at(pos) & 0xF0) >> 4;
-				else
-					data = parentRawData.at(pos) & 0x0F;
+			if (i == 0)
+				data = (parentRawData.at(pos) & 0xF0) >> 4;
+			else
+				data = parentRawData.at(pos) & 0x0F;
 
-				uint8_t grayscale = ((data & 0x0E) >> 1) * 32;
-				uint8_t alpha = (data & 0x01) * 255;
+			uint8_t grayscale = ((data & 0x0E) >> 1) * 32;
+			uint8_t alpha = (data & 0x01) * 255;
 
-				textureData.SetGrayscalePixel(y, x + i, grayscale, alpha);
-			}
+			row[(x + i) * 4 + 0] = grayscale;
+			row[(x + i) * 4 + 1] = grayscale;
+			row[(x + i) * 4 + 2] = grayscale;
+			row[(x + i) * 4 + 3] = alpha;
 		}
 	}
 }
 
-void ZTexture::PrepareBitmapGrayscaleAlpha8()
+void ZTexture::PrepareBitmapRowGrayscaleAlpha8(size_t y, uint8_t* row) const
 {
-	textureData.InitEmptyRGBImage(width, height, true);
-	auto parentRawData = parent->GetRawData();
-	for (size_t y = 0; y < height; y++)
+	const auto& parentRawData = parent->GetRawData();
+	for (size_t x = 0; x < width; x++)
 	{
-		for (size_t x = 0; x < width; x++)
-		{
-			size_t pos = rawDataIndex + ((y * width) + x) * 1;
-			uint8_t grayscale = parentRawData.at(pos) & 0xF0;
-			uint8_t alpha = (parentRawData.at(pos) & 0x0F) << 4;
+		size_t pos = rawDataIndex + ((y * width) + x) * 1;
+		uint8_t grayscale = parentRawData.at(pos) & 0xF0;
+		uint8_t alpha = (parentRawData.at(pos) & 0x0F) << 4;
 
-			textureData.SetGrayscalePixel(y, x, grayscale, alpha);
-		}
+		row[x * 4 + 0] = grayscale;
+		row[x * 4 + 1] = grayscale;
+		row[x * 4 + 2] = grayscale;
+		row[x * 4 + 3] = alpha;
 	}
 }
 
-void ZTexture::PrepareBitmapGrayscaleAlpha16()
+void ZTexture::PrepareBitmapRowGrayscaleAlpha16(size_t y, uint8_t* row) const
 {
-	textureData.InitEmptyRGBImage(width, height, true);
-	auto parentRawData = parent->GetRawData();
-	for (size_t y = 0; y < height; y++)
+	const auto& parentRawData = parent->GetRawData();
+	for (size_t x = 0; x < width; x++)
 	{
-		for (size_t x = 0; x < width; x++)
-		{
-			size_t pos = rawDataIndex + ((y * width) + x) * 2;
-			uint8_t grayscale = parentRawData.at(pos + 0);
-			uint8_t alpha = parentRawData.at(pos + 1);
+		size_t pos = rawDataIndex + ((y * width) + x) * 2;
+		uint8_t grayscale = parentRawData.at(pos + 0);
+		uint8_t alpha = parentRawData.at(pos + 1);
 
-			textureData.SetGrayscalePixel(y, x, grayscale, alpha);
-		}
+		row[x * 4 + 0] = grayscale;
+		row[x * 4 + 1] = grayscale;
+		row[x * 4 + 2] = grayscale;
+		row[x * 4 + 3] = alpha;
 	}
 }
 
-void ZTexture::PrepareBitmapPalette4()
+void ZTexture::PrepareBitmapRowPalette4(size_t y, uint8_t* row) const
 {
-	textureData.InitEmptyPaletteImage(width, height);
-	auto parentRawData = parent->GetRawData();
-	for (size_t y = 0; y < height; y++)
+	const auto& parentRawData = parent->GetRawData();
+	for (size_t x = 0; x < width; x += 2)
 	{
-		for (size_t x = 0; x < width; x += 2)
+		for (uint16_t i = 0; i < 2; i++)
 		{
-			for (uint16_t i = 0; i < 2; i++)
-			{
-				size_t pos = rawDataIndex + ((y * width) + x) / 2;
-				uint8_t paletteIndex = 0;
+			size_t pos = rawDataIndex + ((y * width) + x) / 2;
+			uint8_t paletteIndex = 0;
 
-				if (i == 0)
-					paletteIndex = (parentRawData.at(pos) & 0xF0) >> 4;
-				else
-					paletteIndex = (parentRawData.at(pos) & 0x0F);
+			if (i == 0)
+				paletteIndex = (parentRawData.at(pos) & 0xF0) >> 4;
+			else
+				paletteIndex = (parentRawData.at(pos) & 0x0F);
 
-				textureData.SetIndexedPixel(y, x + i, paletteIndex, paletteIndex * 16);
-			}
+			row[x + i] = paletteIndex;
 		}
 	}
 }
 
-void ZTexture::PrepareBitmapPalette8()
+void ZTexture::PrepareBitmapRowPalette8(size_t y, uint8_t* row) const
 {
-	textureData.InitEmptyPaletteImage(width, height);
-	auto parentRawData = parent->GetRawData();
-	for (size_t y = 0; y < height; y++)
+	const auto& parentRawData = parent->GetRawData();
+	for (size_t x = 0; x < width; x++)
 	{
-		for (size_t x = 0; x < width; x++)
-		{
-			size_t pos = rawDataIndex + ((y * width) + x) * 1;
-			uint8_t grayscale = parentRawData.at(pos);
+		size_t pos = rawDataIndex + ((y * width) + x) * 1;
 
-			textureData.SetIndexedPixel(y, x, grayscale, grayscale);
-		}
+		row[x] = parentRawData.at(pos);
 	}
 }
 
@@ -724,15 +784,31 @@ void ZTexture::Save(const fs::path& outFolder)
 	{
 		File::WriteAllText(Globals::Instance->outputPath / (outName + ".txt"),
 		                   StringHelper::Sprintf("%08lX", hash));
+		parent->AddOutputFile(Globals::Instance->outputPath / (outName + ".txt"));
 	}
 
 	auto outPath = GetPoolOutPath(outFolder);
+	auto outFileName = outPath / (outName + "." + GetExternalExtension() + ".png");
+
+	if (Globals::Instance->dedupTextures)
+	{
+		AddToTexturePool(outFolder);
+
+		TexturePoolEntry* poolEntry = GetPoolEntry();
+		if (poolEntry != nullptr)
+		{
+			// An identical texture was already written, the includes point to that one.
+			if (poolEntry->written)
+				return;
+
+			poolEntry->written = true;
+			outFileName = poolEntry->path.string() + "." + GetExternalExtension() + ".png";
+		}
+	}
 
 	if (!Directory::Exists(outPath))
 		Directory::CreateDirectory(outPath);
 
-	auto outFileName = outPath / (outName + "." + GetExternalExtension() + ".png");
-
 #ifdef TEXTURE_DEBUG
 	printf("Saving PNG: %s\n", outFileName.c_str());
 	printf("\t Var name: %s\n", name.c_str());
@@ -740,7 +816,12 @@ void ZTexture::Save(const fs::path& outFolder)
 		printf("\t TLUT name: %s\n", tlut->name.c_str());
 #endif
 
-	textureData.WritePng(outFileName);
+	// Only the palette is kept in memory, each row is decoded right before being written.
+	PrepareBitmap();
+	textureData.WritePngRows(outFileName,
+	                         [this](size_t y, uint8_t* row) { PrepareBitmapRow(y, row); });
+	textureData.FreeImageData();
+	parent->AddOutputFile(outFileName);
 
 #ifdef TEXTURE_DEBUG
 	printf("\n");
@@ -788,7 +869,7 @@ std::string ZTexture::GetSourceTypeName() const
 
 void ZTexture::CalcHash()
 {
-	auto parentRawData = parent->GetRawData();
+	const auto& parentRawData = parent->GetRawData();
 	hash = CRC32B(parentRawData.data() + rawDataIndex, GetRawDataSize());
 }
 
@@ -821,12 +902,40 @@ std::string ZTexture::GetExternalExtension() const
 
 fs::path ZTexture::GetPoolOutPath(const fs::path& defaultValue)
 {
-	if (Globals::Instance->cfg.texturePool.find(hash) != Globals::Instance->cfg.texturePool.end())
-		return Path::GetDirectoryName(Globals::Instance->cfg.texturePool[hash].path.string());
+	TexturePoolEntry* poolEntry = GetPoolEntry();
+
+	if (poolEntry != nullptr)
+		return Path::GetDirectoryName(poolEntry->path.string());
 
 	return defaultValue;
 }
 
+TexturePoolEntry* ZTexture::GetPoolEntry() const
+{
+	auto poolEntry = Globals::Instance->cfg.texturePool.find(hash);
+
+	if (poolEntry == Globals::Instance->cfg.texturePool.end())
+		return nullptr;
+
+	// Entries added by `-dt` are only valid for textures of the same format, otherwise the
+	// extension of the shared file wouldn't match.
+	if (poolEntry->second.format != TextureType::Error && poolEntry->second.format != format)
+		return nullptr;
+
+	return &poolEntry->second;
+}
+
+void ZTexture::AddToTexturePool(const fs::path& outFolder)
+{
+	auto& texturePool = Globals::Instance->cfg.texturePool;
+
+	if (texturePool.find(hash) != texturePool.end())
+		return;
+
+	texturePool[hash].path = outFolder / Path::GetFileNameWithoutExtension(outName);
+	texturePool[hash].format = format;
+}
+
 TextureType ZTexture::GetTextureTypeFromString(std::string str)
 {
 	TextureType texType = TextureType::Error;
@@ -883,8 +992,6 @@ void ZTexture::SetTlut(ZTexture* nTlut)
 	assert(IsColorIndexed());
 	assert(nTlut->isPalette);
 	tlut = nTlut;
-
-	textureData.SetPalette(tlut->textureData);
 }
 
 bool ZTexture::HasTlut() const
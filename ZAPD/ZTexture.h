@@ -21,6 +21,8 @@ enum class TextureType
 	GrayscaleAlpha16bpp,
 };
 
+struct TexturePoolEntry;
+
 class ZTexture : public ZResource
 {
 protected:
@@ -32,15 +34,18 @@ protected:
 	uint32_t tlutOffset = static_cast<uint32_t>(-1);
 	ZTexture* tlut = nullptr;
 
-	void PrepareBitmapRGBA16();
-	void PrepareBitmapRGBA32();
-	void PrepareBitmapGrayscale8();
-	void PrepareBitmapGrayscaleAlpha8();
-	void PrepareBitmapGrayscale4();
-	void PrepareBitmapGrayscaleAlpha4();
-	void PrepareBitmapGrayscaleAlpha16();
-	void PrepareBitmapPalette4();
-	void PrepareBitmapPalette8();
+	void PrepareBitmap();
+	void PreparePalette();
+	void PrepareBitmapRow(size_t y, uint8_t* row) const;
+	void PrepareBitmapRowRGBA16(size_t y, uint8_t* row) const;
+	void PrepareBitmapRowRGBA32(size_t y, uint8_t* row) const;
+	void PrepareBitmapRowGrayscale8(size_t y, uint8_t* row) const;
+	void PrepareBitmapRowGrayscaleAlpha8(size_t y, uint8_t* row) const;
+	void PrepareBitmapRowGrayscale4(size_t y, uint8_t* row) const;
+	void PrepareBitmapRowGrayscaleAlpha4(size_t y, uint8_t* row) const;
+	void PrepareBitmapRowGrayscaleAlpha16(size_t y, uint8_t* row) const;
+	void PrepareBitmapRowPalette4(size_t y, uint8_t* row) const;
+	void PrepareBitmapRowPalette8(size_t y, uint8_t* row) const;
 
 	void PrepareRawDataFromFile(const fs::path& inFolder);
 	void PrepareRawDataRGBA16(const fs::path& rgbaPath);
@@ -88,6 +93,8 @@ public:
 	float GetPixelMultiplyer() const;
 	TextureType GetTextureType() const;
 	fs::path GetPoolOutPath(const fs::path& defaultValue);
+	TexturePoolEntry* GetPoolEntry() const;
+	void AddToTexturePool(const fs::path& outFolder);
 	bool IsColorIndexed() const;
 	void SetTlut(ZTexture* nTlut);
 	bool HasTlut() const;
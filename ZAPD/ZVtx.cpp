@@ -1,10 +1,53 @@
 #include "ZVtx.h"
+#include <stdexcept>
 #include "BitConverter.h"
 #include "StringHelper.h"
 #include "ZFile.h"
 
 REGISTER_ZFILENODE(Vtx, ZVtx);
 
+VtxEntry::VtxEntry(const std::vector<uint8_t>& rawData, uint32_t rawDataIndex)
+{
+	const uint8_t* data = rawData.data();
+
+	x = BitConverter::ToInt16BE(data, rawDataIndex + 0);
+	y = BitConverter::ToInt16BE(data, rawDataIndex + 2);
+	z = BitConverter::ToInt16BE(data, rawDataIndex + 4);
+	flag = BitConverter::ToUInt16BE(data, rawDataIndex + 6);
+	s = BitConverter::ToInt16BE(data, rawDataIndex + 8);
+	t = BitConverter::ToInt16BE(data, rawDataIndex + 10);
+	r = data[rawDataIndex + 12];
+	g = data[rawDataIndex + 13];
+	b = data[rawDataIndex + 14];
+	a = data[rawDataIndex + 15];
+}
+
+std::vector<VtxEntry> VtxEntry::ParseArray(const std::vector<uint8_t>& rawData,
+                                           uint32_t rawDataIndex, size_t count)
+{
+	if (rawDataIndex + count * 16 > rawData.size())
+	{
+		throw std::runtime_error(StringHelper::Sprintf(
+			"VtxEntry::ParseArray: Error.\n"
+			"\t %zu vertices at offset 0x%06X go past the end of the file.\n",
+			count, rawDataIndex));
+	}
+
+	std::vector<VtxEntry> vtxList;
+	vtxList.reserve(count);
+
+	for (size_t i = 0; i < count; i++)
+		vtxList.emplace_back(rawData, rawDataIndex + i * 16);
+
+	return vtxList;
+}
+
+std::string VtxEntry::GetBodySourceCode() const
+{
+	return StringHelper::Sprintf("VTX(%i, %i, %i, %i, %i, %i, %i, %i, %i)", x, y, z, s, t, r, g, b,
+	                             a);
+}
+
 ZVtx::ZVtx(ZFile* nParent) : ZResource(nParent)
 {
 	x = 0;
@@ -7,6 +7,27 @@
 #include "ZScalar.h"
 #include "tinyxml2.h"
 
+// Plain 16 bytes vertex, laid out like the N64's Vtx. Used for the vertices loaded by display lists,
+// while ZVtx is only used for vertices declared in the XML.
+class VtxEntry
+{
+public:
+	int16_t x, y, z;
+	uint16_t flag;
+	int16_t s, t;
+	uint8_t r, g, b, a;
+
+	VtxEntry() = default;
+	VtxEntry(const std::vector<uint8_t>& rawData, uint32_t rawDataIndex);
+
+	static std::vector<VtxEntry> ParseArray(const std::vector<uint8_t>& rawData,
+	                                        uint32_t rawDataIndex, size_t count);
+
+	std::string GetBodySourceCode() const;
+};
+
+static_assert(sizeof(VtxEntry) == 16, "VtxEntry must match the size of a Vtx");
+
 class ZVtx : public ZResource
 {
 public: